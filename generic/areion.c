@@ -1,114 +1,72 @@
 #include "hashInt.h"
 #include "areion.h"
+#include "cpu.h"
 
-static inline void aerion_trunc(const uint64_t input[8], uint64_t output[4]) //<<<
+static const struct areion_impl* const areion_impls[] = {	// In order of preference
+#if HAVE_VAES
+	&areion_impl_vaes,
+#endif
+#if HAVE_AES_NI
+	&areion_impl_x86,
+#endif
+#if HAVE_AES_NEON
+	&areion_impl_neon,
+#endif
+#if AREION_TTABLE
+	&areion_impl_ttable,		// Opted into at build time: faster, but not constant time
+#endif
+	&areion_impl_bitsliced,		// Constant time, and faster than software
+	&areion_impl_software,
+#if !AREION_TTABLE
+	&areion_impl_ttable,		// Only when asked for, never chosen automatically
+#endif
+};
+
+static const struct areion_impl*	areion = &areion_impl_software;
+static const struct areion_impl*	areion_x4 = NULL;		// Multi-lane kernels for the batch forms, NULL to loop over areion
+
+/*
+ * Install impl, or with impl == NULL the best the host CPU supports.  The
+ * single block functions always come from somewhere (the best available if
+ * impl doesn't have them), the multi-lane ones only from impl when forced.
+ * Automatically chosen multi-lane kernels never come from an impl ranked
+ * below the single block one: looping NEON beats 4 bitsliced lanes.  Other
+ * threads may be hashing with the current choice, so both are worked out
+ * first and each is then published with a single store, never NULL or half
+ * chosen.
+ */
+static void areion_select(const struct areion_impl* impl) //<<<
 {
-	output[0] = input[1];
-	output[1] = input[3];
-	output[2] = input[4];
-	output[3] = input[6];
-}
+	const struct areion_impl*	single = impl && impl->perm256  ? impl : NULL;
+	const struct areion_impl*	multi  = impl && impl->dm512_x4 ? impl : NULL;
 
-//>>>
+	for (size_t i=0; i<sizeof(areion_impls)/sizeof(areion_impls[0]); i++) {
+		const struct areion_impl*	candidate = areion_impls[i];
 
-// VIL construction (Merkle-Damgård) <<<
-static inline void vil_init(vil_context*restrict ctx) //<<<
-{
-	*ctx = (vil_context){
-		.state = {
-			0x6a, 0x09, 0xe6, 0x67, 0xbb, 0x67, 0xae, 0x85, 0x3c, 0x6e, 0xf3, 0x72, 0xa5, 0x4f, 0xf5, 0x3a,
-			0x51, 0x0e, 0x52, 0x7f, 0x9b, 0x05, 0x68, 0x8c, 0x1f, 0x83, 0xd9, 0xab, 0x5b, 0xe0, 0xcd, 0x19,
+		if (!CPU_HAS(candidate->requires)) continue;
+		if (impl == NULL && multi == NULL && candidate->dm512_x4)	multi = candidate;
+		if (single == NULL && candidate->perm256) {
+			single = candidate;
+			if (impl == NULL) break;
 		}
-	};
+	}
+
+	areion    = single ? single : &areion_impl_software;
+	areion_x4 = multi;
 }
 
 //>>>
-static inline void vil_compress(vil_context*restrict ctx, const uint8_t block[32]) //<<<
-{
-	uint8_t	tmp[64];
 
-#if HAVE_AES_NI
-	__m128i x[4] = {
-		_mm_loadu_si128((__m128i*)(block)),
-		_mm_loadu_si128((__m128i*)(block + 16)),
-		_mm_loadu_si128((__m128i*)(ctx->state)),
-		_mm_loadu_si128((__m128i*)(ctx->state + 16))
-	};
-	__m128i orig_x0 = x[0];
-	__m128i orig_x1 = x[1];
-	__m128i orig_x2 = x[2];
-	__m128i orig_x3 = x[3];
-
-	__m128i	out[4];
-	permute_areion_512(out, x);
-	x[0] = _mm_xor_si128(out[0], orig_x0);
-	x[1] = _mm_xor_si128(out[1], orig_x1);
-	x[2] = _mm_xor_si128(out[2], orig_x2);
-	x[3] = _mm_xor_si128(out[3], orig_x3);
-
-	_mm_storeu_si128((__m128i*) tmp,       x[0]);
-	_mm_storeu_si128((__m128i*)(tmp + 16), x[1]);
-	_mm_storeu_si128((__m128i*)(tmp + 32), x[2]);
-	_mm_storeu_si128((__m128i*)(tmp + 48), x[3]);
-#elif HAVE_AES_NEON
-	uint8x16_t x0 = vld1q_u8(block);
-	uint8x16_t x1 = vld1q_u8(block + 16);
-	uint8x16_t x2 = vld1q_u8(ctx->state);
-	uint8x16_t x3 = vld1q_u8(ctx->state + 16);
-	uint8x16_t orig_x0 = x0;
-	uint8x16_t orig_x1 = x1;
-	uint8x16_t orig_x2 = x2;
-	uint8x16_t orig_x3 = x3;
-
-	perm512(x0, x1, x2, x3);
-
-	// Match X86 exactly: permute_areion_512 reorders to {x3, x0, x1, x2} then XORs with original
-	uint8x16_t perm_x0 = x0, perm_x1 = x1, perm_x2 = x2, perm_x3 = x3;
-	x0 = veorq_u8(perm_x3, orig_x0);  // out[0] = x3_permuted XOR orig_x0
-	x1 = veorq_u8(perm_x0, orig_x1);  // out[1] = x0_permuted XOR orig_x1
-	x2 = veorq_u8(perm_x1, orig_x2);  // out[2] = x1_permuted XOR orig_x2
-	x3 = veorq_u8(perm_x2, orig_x3);  // out[3] = x2_permuted XOR orig_x3
-
-	vst1q_u8(tmp,      x0);
-	vst1q_u8(tmp + 16, x1);
-	vst1q_u8(tmp + 32, x2);
-	vst1q_u8(tmp + 48, x3);
-#else
-	// Software fallback implementation
-	uint8_t x0[16], x1[16], x2[16], x3[16];
-	uint8_t orig_x0[16], orig_x1[16], orig_x2[16], orig_x3[16];
-	
-	memcpy(x0, block,      16);
-	memcpy(x1, block + 16, 16);
-	memcpy(x2, ctx->state,      16);
-	memcpy(x3, ctx->state + 16, 16);
-	memcpy(orig_x0, x0, 16);
-	memcpy(orig_x1, x1, 16);
-	memcpy(orig_x2, x2, 16);
-	memcpy(orig_x3, x3, 16);
-	
-	perm512(x0, x1, x2, x3);
-	// Match X86 exactly: permute_areion_512 reorders to {x3, x0, x1, x2} then XORs with original
-	uint8_t perm_x0[16], perm_x1[16], perm_x2[16], perm_x3[16];
-	memcpy(perm_x0, x0, 16);
-	memcpy(perm_x1, x1, 16);
-	memcpy(perm_x2, x2, 16);
-	memcpy(perm_x3, x3, 16);
-	
-	for (int i=0; i<16; i++) {
-		x0[i] = perm_x3[i] ^ orig_x0[i];  // out[0] = x3_permuted XOR orig_x0
-		x1[i] = perm_x0[i] ^ orig_x1[i];  // out[1] = x0_permuted XOR orig_x1  
-		x2[i] = perm_x1[i] ^ orig_x2[i];  // out[2] = x1_permuted XOR orig_x2
-		x3[i] = perm_x2[i] ^ orig_x3[i];  // out[3] = x2_permuted XOR orig_x3
-	}
-	
-	memcpy(tmp,      x0, 16);
-	memcpy(tmp + 16, x1, 16);
-	memcpy(tmp + 32, x2, 16);
-	memcpy(tmp + 48, x3, 16);
-#endif
+// VIL construction (Merkle-Damgård) <<<
+static const uint8_t vil_iv[32] = {
+	0x6a, 0x09, 0xe6, 0x67, 0xbb, 0x67, 0xae, 0x85, 0x3c, 0x6e, 0xf3, 0x72, 0xa5, 0x4f, 0xf5, 0x3a,
+	0x51, 0x0e, 0x52, 0x7f, 0x9b, 0x05, 0x68, 0x8c, 0x1f, 0x83, 0xd9, 0xab, 0x5b, 0xe0, 0xcd, 0x19,
+};
 
-	aerion_trunc((const uint64_t*)tmp, (uint64_t*)ctx->state);
+static inline void vil_init(vil_context*restrict ctx) //<<<
+{
+	*ctx = (vil_context){0};
+	memcpy(ctx->state, vil_iv, 32);
 }
 
 //>>>
@@ -125,16 +83,17 @@ static inline void vil_update(vil_context*restrict ctx, const uint8_t*restrict d
 	if (ctx->buffer_len > 0) {
 		const uint32_t	needed = 32 - ctx->buffer_len;
 		memcpy(ctx->buffer + ctx->buffer_len, data, needed);
-		vil_compress(ctx, ctx->buffer);
+		areion->md_compress(ctx->state, ctx->buffer, 1);
 		data += needed;
 		len  -= needed;
 		ctx->buffer_len = 0;
 	}
 
-	while (len >= 32) {
-		vil_compress(ctx, data);
-		data += 32;
-		len  -= 32;
+	if (len >= 32) {
+		const uint64_t	blocks = len / 32;
+		areion->md_compress(ctx->state, data, blocks);
+		data += blocks * 32;
+		len  -= blocks * 32;
 	}
 
 	if (len > 0) {
@@ -143,56 +102,293 @@ static inline void vil_update(vil_context*restrict ctx, const uint8_t*restrict d
 	}
 }
 
+//>>>
+// Build the padded final block(s) from the len < 32 leftover bytes in tail, returns how many
+static inline int vil_pad(uint8_t out[64], const uint8_t*restrict tail, uint32_t len, uint64_t total_len) //<<<
+{
+	const int		blocks = len < 24 ? 1 : 2;
+	uint8_t*const	len_field = out + blocks*32 - 8;
+
+	memcpy(out, tail, len);
+	memset(out + len, 0, blocks*32 - len);
+	out[len] = 0x80;
+
+	const uint64_t	bit_len = total_len * 8;
+	len_field[0] = (bit_len >> 56) & 0xFF;
+	len_field[1] = (bit_len >> 48) & 0xFF;
+	len_field[2] = (bit_len >> 40) & 0xFF;
+	len_field[3] = (bit_len >> 32) & 0xFF;
+	len_field[4] = (bit_len >> 24) & 0xFF;
+	len_field[5] = (bit_len >> 16) & 0xFF;
+	len_field[6] = (bit_len >>  8) & 0xFF;
+	len_field[7] =  bit_len        & 0xFF;
+
+	return blocks;
+}
+
 //>>>
 static inline void vil_final(vil_context*restrict ctx, uint8_t output[32]) //<<<
 {
-	uint8_t		final_block[32];
-	uint32_t	pad_len;
-
-	if (ctx->buffer_len < 24) {
-		pad_len = 24 - ctx->buffer_len;
-		memcpy(final_block, ctx->buffer, ctx->buffer_len);
-		memset(final_block + ctx->buffer_len, 0, pad_len);
-		final_block[ctx->buffer_len] = 0x80;
+	uint8_t		final_blocks[64];
+
+	areion->md_compress(ctx->state, final_blocks, vil_pad(final_blocks, ctx->buffer, ctx->buffer_len, ctx->total_len));
+
+	memcpy(output, ctx->state, 32);
+}
+
+//>>>
+/*
+ * One shot: the full blocks go straight from data through a single
+ * md_compress call (which keeps the chaining value in registers throughout),
+ * then the padded tail, without the context's buffering
+ */
+static inline void vil_hash(const uint8_t*restrict data, uint64_t len, uint8_t output[32]) //<<<
+{
+	const uint64_t	full = len / 32;
+	uint8_t			tail[64];
+
+	memcpy(output, vil_iv, 32);
+	if (full) areion->md_compress(output, data, full);
+	areion->md_compress(output, tail, vil_pad(tail, data + full*32, len % 32, len));
+}
+
+//>>>
+// Streaming interface, for the hash context values in context.c
+void areion512_md_init(vil_context* ctx)										{vil_init(ctx);}
+void areion512_md_update(vil_context* ctx, const uint8_t* data, uint64_t len)	{vil_update(ctx, data, len);}
+void areion512_md_final(vil_context* ctx, uint8_t output[32])					{vil_final(ctx, output);}
+
+// Batch: independent messages advanced in lockstep through md_compress_x4 <<<
+typedef struct {
+	const uint8_t*	p;				// Next block for this lane
+	uint64_t		left;			// Blocks left at p
+	size_t			msg;			// Index of the message in the batch
+	int				busy;
+	int				in_tail;		// p points into tail rather than the message
+	int				tail_blocks;
+	uint8_t			tail[64];		// The padded final block(s)
+} vil_lane;
+
+static void vil_lane_start(vil_lane* lane, uint8_t state[32], size_t msg, const uint8_t* data, uint64_t len) //<<<
+{
+	const uint64_t	full = len / 32;
+
+	memcpy(state, vil_iv, 32);
+
+	lane->tail_blocks = vil_pad(lane->tail, data + full*32, len % 32, len);
+	lane->msg         = msg;
+	lane->busy        = 1;
+	if (full) {
+		lane->p       = data;
+		lane->left    = full;
+		lane->in_tail = 0;
 	} else {
-		pad_len = 32 - ctx->buffer_len;
-		memcpy(final_block, ctx->buffer, ctx->buffer_len);
-		memset(final_block + ctx->buffer_len, 0, pad_len);
-		final_block[ctx->buffer_len] = 0x80;
-		vil_compress(ctx, final_block);
-		memset(final_block, 0, 24);
+		lane->p       = lane->tail;
+		lane->left    = lane->tail_blocks;
+		lane->in_tail = 1;
 	}
+}
 
-	const uint64_t	bit_len = ctx->total_len * 8;
-	final_block[24] = (bit_len >> 56) & 0xFF;
-	final_block[25] = (bit_len >> 48) & 0xFF;
-	final_block[26] = (bit_len >> 40) & 0xFF;
-	final_block[27] = (bit_len >> 32) & 0xFF;
-	final_block[28] = (bit_len >> 24) & 0xFF;
-	final_block[29] = (bit_len >> 16) & 0xFF;
-	final_block[30] = (bit_len >>  8) & 0xFF;
-	final_block[31] =  bit_len        & 0xFF;
+//>>>
+// Move the lane on by n blocks, returns 1 when its message is done
+static int vil_lane_advance(vil_lane* lane, uint64_t n) //<<<
+{
+	lane->p    += n*32;
+	lane->left -= n;
+	if (lane->left) return 0;
 
-	vil_compress(ctx, final_block);
+	if (lane->in_tail) {
+		lane->busy = 0;
+		return 1;
+	}
 
-#if HAVE_AES_NI
-	//_mm_storeu_si128((__m128i*) output,       ctx->x2);
-	//_mm_storeu_si128((__m128i*)(output + 16), ctx->x3);
-#elif HAVE_AES_NEON
-	//vst1q_u8(output,      ctx->x2);
-	//vst1q_u8(output + 16, ctx->x3);
-#endif
-	memcpy(output, ctx->state, 32);
+	lane->p       = lane->tail;
+	lane->left    = lane->tail_blocks;
+	lane->in_tail = 1;
+	return 0;
 }
 
 //>>>
-static inline void vil_hash(const uint8_t*restrict data, uint64_t len, uint8_t output[32]) //<<<
+static void vil_hash_batch(size_t count, const uint8_t* const data[], const uint64_t len[], uint8_t out[][32]) //<<<
 {
-	vil_context	ctx;
+	void (*x4)(uint8_t state[4][32], const uint8_t* const data[4], size_t nblocks) = areion_x4 ? areion_x4->md_compress_x4 : NULL;
+	vil_lane		lane[4] = {0};
+	uint8_t			state[4][32] = {{0}};
+	size_t			next = 0;
+
+	if (x4 == NULL) {
+		for (size_t i=0; i<count; i++)
+			vil_hash(data[i], len[i], out[i]);
+		return;
+	}
 
-	vil_init(&ctx);
-	vil_update(&ctx, data, len);
-	vil_final(&ctx, output);
+	for (;;) {
+		const uint8_t*	ptr[4];
+		const uint8_t*	spare = NULL;
+		uint64_t		n = 0;
+		int				active = 0;
+
+		// Refill idle lanes
+		for (int l=0; l<4 && next < count; l++) {
+			if (lane[l].busy) continue;
+			vil_lane_start(&lane[l], state[l], next, data[next], len[next]);
+			next++;
+		}
+
+		// Step by the shortest run of blocks, idle lanes shadow a busy one
+		for (int l=0; l<4; l++) {
+			if (!lane[l].busy) continue;
+			active++;
+			spare = lane[l].p;
+			if (n == 0 || lane[l].left < n) n = lane[l].left;
+		}
+		if (active == 0) break;
+
+		if (next == count && active <= 2) {
+			// Nothing left to refill with, the single stream path is as fast for the stragglers
+			for (int l=0; l<4; l++) {
+				if (!lane[l].busy) continue;
+				while (lane[l].busy) {
+					areion->md_compress(state[l], lane[l].p, lane[l].left);
+					vil_lane_advance(&lane[l], lane[l].left);
+				}
+				memcpy(out[lane[l].msg], state[l], 32);
+			}
+			break;
+		}
+
+		for (int l=0; l<4; l++)
+			ptr[l] = lane[l].busy ? lane[l].p : spare;
+
+		// md_compress_x4 takes a size_t count, step in pieces that fit
+		if (n > SIZE_MAX/32) n = SIZE_MAX/32;
+		x4(state, ptr, n);
+
+		for (int l=0; l<4; l++)
+			if (lane[l].busy && vil_lane_advance(&lane[l], n))
+				memcpy(out[lane[l].msg], state[l], 32);
+	}
+}
+
+//>>>
+//>>>
+//>>>
+// Batch Davies-Meyer and VIL <<<
+static void dm_batch(size_t count, const uint8_t* const in[], uint8_t out[][32], size_t block_len) //<<<
+{
+	const struct areion_impl*	single = areion;		// Loaded once, areion_select may be replacing them
+	const struct areion_impl*	multi  = areion_x4;
+	void (*x4)(uint8_t out[4][32], const uint8_t* const in[4]) = NULL;
+	void (*x1)(uint8_t out[32], const uint8_t* in);
+	size_t	i = 0;
+
+	if (block_len == 32) {
+		x1 = single->dm256;
+		if (multi) x4 = multi->dm256_x4;
+	} else {
+		x1 = single->dm512;
+		if (multi) x4 = multi->dm512_x4;
+	}
+
+	if (x4) {
+		for (; i+4 <= count; i += 4)
+			x4(out + i, in + i);
+
+		if (i < count) {
+			// Pad the last group out with copies of its first block
+			const uint8_t*	lane_in[4];
+			uint8_t			lane_out[4][32];
+
+			for (size_t lane=0; lane<4; lane++)
+				lane_in[lane] = in[i + lane < count ? i + lane : i];
+			x4(lane_out, lane_in);
+			memcpy(out + i, lane_out, (count - i) * 32);
+			i = count;
+		}
+	}
+
+	for (; i<count; i++)
+		x1(out[i], in[i]);
+}
+
+//>>>
+// Batch interface, for hash::batch in batch.c
+void areion_dm_batch(size_t count, const uint8_t* const in[], uint8_t out[][32], size_t block_len)		{dm_batch(count, in, out, block_len);}
+void areion512_md_batch(size_t count, const uint8_t* const data[], const uint64_t len[], uint8_t out[][32])	{vil_hash_batch(count, data, len, out);}
+
+static int dm_batch_obj(Tcl_Interp* interp, Tcl_Obj* blocks, size_t block_len, enum digest_format format) //<<<
+{
+	int				code = TCL_OK;
+	Tcl_Size		count;
+	Tcl_Obj**		ov;
+	const uint8_t**	in = NULL;
+	uint8_t			(*out)[32] = NULL;
+	Tcl_Obj*		res = NULL;
+
+	TEST_OK_LABEL(finally, code, Tcl_ListObjGetElements(interp, blocks, &count, &ov));
+
+	in  = ckalloc(sizeof(in[0])  * (count ? count : 1));
+	out = ckalloc(sizeof(out[0]) * (count ? count : 1));
+
+	for (Tcl_Size i=0; i<count; i++) {
+		Tcl_Size	len;
+		in[i] = Tcl_GetBytesFromObj(interp, ov[i], &len);
+		if (in[i] == NULL) {code = TCL_ERROR; goto finally;}
+		if ((size_t)len != block_len)
+			THROW_PRINTF_LABEL(finally, code, "block must be %d bytes long", (int)block_len);
+	}
+
+	dm_batch(count, in, out, block_len);
+
+	res = Tcl_NewListObj(count, NULL);
+	for (Tcl_Size i=0; i<count; i++)
+		Tcl_ListObjAppendElement(NULL, res, digest_obj(out[i], 32, format));
+
+	Tcl_SetObjResult(interp, res);
+
+finally:
+	if (in)		ckfree(in);
+	if (out)	ckfree(out);
+	return code;
+}
+
+//>>>
+static int md_batch_obj(Tcl_Interp* interp, Tcl_Obj* messages, enum digest_format format) //<<<
+{
+	int				code = TCL_OK;
+	Tcl_Size		count;
+	Tcl_Obj**		ov;
+	const uint8_t**	data = NULL;
+	uint64_t*		lens = NULL;
+	uint8_t			(*out)[32] = NULL;
+	Tcl_Obj*		res = NULL;
+
+	TEST_OK_LABEL(finally, code, Tcl_ListObjGetElements(interp, messages, &count, &ov));
+
+	data = ckalloc(sizeof(data[0]) * (count ? count : 1));
+	lens = ckalloc(sizeof(lens[0]) * (count ? count : 1));
+	out  = ckalloc(sizeof(out[0])  * (count ? count : 1));
+
+	for (Tcl_Size i=0; i<count; i++) {
+		Tcl_Size	len;
+		data[i] = Tcl_GetBytesFromObj(interp, ov[i], &len);
+		if (data[i] == NULL) {code = TCL_ERROR; goto finally;}
+		lens[i] = len;
+	}
+
+	vil_hash_batch(count, data, lens, out);
+
+	res = Tcl_NewListObj(count, NULL);
+	for (Tcl_Size i=0; i<count; i++)
+		Tcl_ListObjAppendElement(NULL, res, digest_obj(out[i], 32, format));
+
+	Tcl_SetObjResult(interp, res);
+
+finally:
+	if (data)	ckfree(data);
+	if (lens)	ckfree(lens);
+	if (out)	ckfree(out);
+	return code;
 }
 
 //>>>
@@ -212,28 +408,7 @@ static OBJCMD(areion_perm256_cmd) //<<<
 	if (len != 32) THROW_ERROR_LABEL(finally, code, "block must be 32 bytes long");
 
 	uint8_t	res[32];
-
-#if HAVE_AES_NI
-	__m128i	x0 = _mm_loadu_si128((__m128i*)(input));
-	__m128i	x1 = _mm_loadu_si128((__m128i*)(input + 16));
-	perm256(x0, x1);
-	_mm_storeu_si128((__m128i*) res,       x0);
-	_mm_storeu_si128((__m128i*)(res + 16), x1);
-#elif HAVE_AES_NEON
-	uint8x16_t	x0 = vld1q_u8(input);
-	uint8x16_t	x1 = vld1q_u8(input + 16);
-	perm256(x0, x1);
-	vst1q_u8(res,      x0);
-	vst1q_u8(res + 16, x1);
-#else
-	// Software fallback implementation
-	uint8_t	x0[16], x1[16];
-	memcpy(x0, input, 16);
-	memcpy(x1, input + 16, 16);
-	sw_perm256_x86_compatible(x0, x1);
-	memcpy(res,      x0, 16);
-	memcpy(res + 16, x1, 16);
-#endif
+	areion->perm256(res, input);
 
 	Tcl_SetObjResult(interp, Tcl_NewByteArrayObj(res, 32));
 
@@ -256,34 +431,7 @@ static OBJCMD(areion_perm512_cmd) //<<<
 	if (len != 64) THROW_ERROR_LABEL(finally, code, "block must be 64 bytes long");
 
 	uint8_t	res[64];
-
-#if HAVE_AES_NI
-	__m128i	x0 = _mm_loadu_si128((__m128i*)(input));
-	__m128i	x1 = _mm_loadu_si128((__m128i*)(input + 16));
-	__m128i	x2 = _mm_loadu_si128((__m128i*)(input + 32));
-	__m128i	x3 = _mm_loadu_si128((__m128i*)(input + 48));
-
-	__m128i	out[4];
-	permute_areion_512(out, (__m128i[]){x0, x1, x2, x3});
-
-	_mm_storeu_si128((__m128i*) res,       out[0]);
-	_mm_storeu_si128((__m128i*)(res + 16), out[1]);
-	_mm_storeu_si128((__m128i*)(res + 32), out[2]);
-	_mm_storeu_si128((__m128i*)(res + 48), out[3]);
-#elif HAVE_AES_NEON
-	uint8x16_t	x0 = vld1q_u8(input);
-	uint8x16_t	x1 = vld1q_u8(input + 16);
-	uint8x16_t	x2 = vld1q_u8(input + 32);
-	uint8x16_t	x3 = vld1q_u8(input + 48);
-	perm512(x0, x1, x2, x3);
-	vst1q_u8(res,      x3);
-	vst1q_u8(res + 16, x0);
-	vst1q_u8(res + 32, x1);
-	vst1q_u8(res + 48, x2);
-#else
-	// Software fallback implementation
-	permute_areion_512((uint8_t(*)[16])res, (const uint8_t(*)[16])input);
-#endif
+	areion->perm512(res, input);
 
 	Tcl_SetObjResult(interp, Tcl_NewByteArrayObj(res, 64));
 
@@ -295,60 +443,24 @@ finally:
 static OBJCMD(areion256_dm_cmd) //<<<
 {
 	(void)cdata;
-	int			code = TCL_OK;
+	int					code = TCL_OK;
+	struct digest_opts	opts = {.format = DIGEST_BINARY};
+	int					argi;
 
-	enum {A_cmd, A_BLOCK, A_objc};
-	CHECK_ARGS_LABEL(finally, code, "block");
+	TEST_OK_LABEL(finally, code, digest_options(interp, objc, objv, 1, "?-batch? ?-format format? block", DIGEST_OPT_BATCH|DIGEST_OPT_FORMAT, &opts, &argi));
+
+	if (opts.batch)
+		return dm_batch_obj(interp, objv[argi], 32, opts.format);
 
 	Tcl_Size len;
-	const uint8_t*	input = Tcl_GetBytesFromObj(interp, objv[A_BLOCK], &len);
+	const uint8_t*	input = Tcl_GetBytesFromObj(interp, objv[argi], &len);
 	if (input == NULL) {code = TCL_ERROR; goto finally;}
 	if (len != 32) THROW_ERROR_LABEL(finally, code, "block must be 32 bytes long");
 
 	uint8_t	res[32];
+	areion->dm256(res, input);
 
-#if HAVE_AES_NI
-	__m128i	x0 = _mm_loadu_si128((__m128i*)(input));
-	__m128i	x1 = _mm_loadu_si128((__m128i*)(input + 16));
-	__m128i orig_x0 = x0;
-	__m128i orig_x1 = x1;
-	perm256(x0, x1);
-	x0 = _mm_xor_si128(x0, orig_x0);
-	x1 = _mm_xor_si128(x1, orig_x1);
-	_mm_storeu_si128((__m128i*) res,       x0);
-	_mm_storeu_si128((__m128i*)(res + 16), x1);
-#elif HAVE_AES_NEON
-	uint8x16_t	x0 = vld1q_u8(input);
-	uint8x16_t	x1 = vld1q_u8(input + 16);
-	uint8x16_t	orig_x0 = x0;
-	uint8x16_t	orig_x1 = x1;
-	perm256(x0, x1);
-	x0 = veorq_u8(x0, orig_x0);
-	x1 = veorq_u8(x1, orig_x1);
-	vst1q_u8(res,      x0);
-	vst1q_u8(res + 16, x1);
-#else
-	// Software fallback implementation
-	uint8_t x0[16], x1[16];
-	uint8_t orig_x0[16], orig_x1[16];
-
-	memcpy(x0, input,      16);
-	memcpy(x1, input + 16, 16);
-	memcpy(orig_x0, x0, 16);
-	memcpy(orig_x1, x1, 16);
-
-	perm256(x0, x1);
-
-	for (int i=0; i<16; i++) {
-		x0[i] ^= orig_x0[i];
-		x1[i] ^= orig_x1[i];
-	}
-
-	memcpy(res,      x0, 16);
-	memcpy(res + 16, x1, 16);
-#endif
-
-	Tcl_SetObjResult(interp, Tcl_NewByteArrayObj(res, 32));
+	Tcl_SetObjResult(interp, digest_obj(res, 32, opts.format));
 
 finally:
 	return code;
@@ -358,99 +470,24 @@ finally:
 static OBJCMD(areion512_dm_cmd) //<<<
 {
 	(void)cdata;
-	int			code = TCL_OK;
+	int					code = TCL_OK;
+	struct digest_opts	opts = {.format = DIGEST_BINARY};
+	int					argi;
 
-	enum {A_cmd, A_BLOCK, A_objc};
-	CHECK_ARGS_LABEL(finally, code, "block");
+	TEST_OK_LABEL(finally, code, digest_options(interp, objc, objv, 1, "?-batch? ?-format format? block", DIGEST_OPT_BATCH|DIGEST_OPT_FORMAT, &opts, &argi));
+
+	if (opts.batch)
+		return dm_batch_obj(interp, objv[argi], 64, opts.format);
 
 	Tcl_Size len;
-	const uint8_t*	input = Tcl_GetBytesFromObj(interp, objv[A_BLOCK], &len);
+	const uint8_t*	input = Tcl_GetBytesFromObj(interp, objv[argi], &len);
 	if (input == NULL) {code = TCL_ERROR; goto finally;}
 	if (len != 64) THROW_ERROR_LABEL(finally, code, "block must be 64 bytes long");
 
-	uint8_t	tmp[64];
-
-#if HAVE_AES_NI
-	__m128i	x0 = _mm_loadu_si128((__m128i*)(input));
-	__m128i	x1 = _mm_loadu_si128((__m128i*)(input + 16));
-	__m128i	x2 = _mm_loadu_si128((__m128i*)(input + 32));
-	__m128i	x3 = _mm_loadu_si128((__m128i*)(input + 48));
-	__m128i orig_x0 = x0;
-	__m128i orig_x1 = x1;
-	__m128i orig_x2 = x2;
-	__m128i orig_x3 = x3;
-
-	__m128i	out[4];
-	permute_areion_512(out, (__m128i[]){x0, x1, x2, x3});
-	x0 = _mm_xor_si128(out[0], orig_x0);
-	x1 = _mm_xor_si128(out[1], orig_x1);
-	x2 = _mm_xor_si128(out[2], orig_x2);
-	x3 = _mm_xor_si128(out[3], orig_x3);
-
-	_mm_storeu_si128((__m128i*) tmp,       x0);
-	_mm_storeu_si128((__m128i*)(tmp + 16), x1);
-	_mm_storeu_si128((__m128i*)(tmp + 32), x2);
-	_mm_storeu_si128((__m128i*)(tmp + 48), x3);
-#elif HAVE_AES_NEON
-	uint8x16_t	x0 = vld1q_u8(input);
-	uint8x16_t	x1 = vld1q_u8(input + 16);
-	uint8x16_t	x2 = vld1q_u8(input + 32);
-	uint8x16_t	x3 = vld1q_u8(input + 48);
-	uint8x16_t	orig_x0 = x0;
-	uint8x16_t	orig_x1 = x1;
-	uint8x16_t	orig_x2 = x2;
-	uint8x16_t	orig_x3 = x3;
-
-	perm512(x0, x1, x2, x3);
-	// Match X86 exactly: permute_areion_512 reorders to {x3, x0, x1, x2} then XORs with original
-	uint8x16_t perm_x0 = x0, perm_x1 = x1, perm_x2 = x2, perm_x3 = x3;
-	x0 = veorq_u8(perm_x3, orig_x0);  // out[0] = x3_permuted XOR orig_x0
-	x1 = veorq_u8(perm_x0, orig_x1);  // out[1] = x0_permuted XOR orig_x1
-	x2 = veorq_u8(perm_x1, orig_x2);  // out[2] = x1_permuted XOR orig_x2
-	x3 = veorq_u8(perm_x2, orig_x3);  // out[3] = x2_permuted XOR orig_x3
-	vst1q_u8(tmp,      x0);
-	vst1q_u8(tmp + 16, x1);
-	vst1q_u8(tmp + 32, x2);
-	vst1q_u8(tmp + 48, x3);
-#else
-	// Software fallback implementation
-	uint8_t x0[16], x1[16], x2[16], x3[16];
-	uint8_t orig_x0[16], orig_x1[16], orig_x2[16], orig_x3[16];
-
-	memcpy(x0, input,      16);
-	memcpy(x1, input + 16, 16);
-	memcpy(x2, input + 32, 16);
-	memcpy(x3, input + 48, 16);
-	memcpy(orig_x0, x0, 16);
-	memcpy(orig_x1, x1, 16);
-	memcpy(orig_x2, x2, 16);
-	memcpy(orig_x3, x3, 16);
-
-	perm512(x0, x1, x2, x3);
-	// Match X86 exactly: permute_areion_512 reorders to {x3, x0, x1, x2} then XORs with original
-	uint8_t perm_x0[16], perm_x1[16], perm_x2[16], perm_x3[16];
-	memcpy(perm_x0, x0, 16);
-	memcpy(perm_x1, x1, 16);
-	memcpy(perm_x2, x2, 16);
-	memcpy(perm_x3, x3, 16);
-
-	for (int i=0; i<16; i++) {
-		x0[i] = perm_x3[i] ^ orig_x0[i];  // out[0] = x3_permuted XOR orig_x0
-		x1[i] = perm_x0[i] ^ orig_x1[i];  // out[1] = x0_permuted XOR orig_x1  
-		x2[i] = perm_x1[i] ^ orig_x2[i];  // out[2] = x1_permuted XOR orig_x2
-		x3[i] = perm_x2[i] ^ orig_x3[i];  // out[3] = x2_permuted XOR orig_x3
-	}
-
-	memcpy(tmp,      x0, 16);
-	memcpy(tmp + 16, x1, 16);
-	memcpy(tmp + 32, x2, 16);
-	memcpy(tmp + 48, x3, 16);
-#endif
-
 	uint8_t	res[32];
-	aerion_trunc((const uint64_t*)tmp, (uint64_t*)res);
+	areion->dm512(res, input);
 
-	Tcl_SetObjResult(interp, Tcl_NewByteArrayObj(res, 32));
+	Tcl_SetObjResult(interp, digest_obj(res, 32, opts.format));
 
 finally:
 	return code;
@@ -460,18 +497,29 @@ finally:
 static OBJCMD(areion512_md_cmd) //<<<
 {
 	(void)cdata;
-	int			code = TCL_OK;
+	int					code = TCL_OK;
+	struct digest_opts	opts = {.format = DIGEST_BINARY};
+	int					argi;
 
-	enum {A_cmd, A_BYTES, A_objc};
-	CHECK_ARGS_LABEL(finally, code, "bytes");
+	TEST_OK_LABEL(finally, code, digest_options(interp, objc, objv, 1, "?-batch? ?-encoding encoding? ?-format format? ?-length length? ?-memo? ?-offset offset? ?--? bytes ?bytes ...?", DIGEST_OPT_BATCH|DIGEST_OPT_ENCODING|DIGEST_OPT_FORMAT|DIGEST_OPT_MEMO|DIGEST_OPT_PARTS|DIGEST_OPT_RANGE, &opts, &argi));
 
-	Tcl_Size len;
-	const uint8_t*	input = Tcl_GetBytesFromObj(interp, objv[A_BYTES], &len);
-	if (input == NULL) {code = TCL_ERROR; goto finally;}
+	if (opts.batch)
+		return md_batch_obj(interp, objv[argi], opts.format);
 
 	uint8_t	res[32];
-	vil_hash(input, len, res);
-	Tcl_SetObjResult(interp, Tcl_NewByteArrayObj(res, 32));
+	if (!opts.memo || !memo_lookup(interp, objv[argi], HASH_AREION512_MD, opts.utf8, res, 32)) {
+		if (!DIGEST_PLAIN(&opts)) {
+			TEST_OK_LABEL(finally, code, hash_parts(interp, HASH_AREION512_MD, objv+argi, &opts, res));
+		} else {
+			Tcl_Size len;
+			const uint8_t*	input = Tcl_GetBytesFromObj(interp, objv[argi], &len);
+			if (input == NULL) {code = TCL_ERROR; goto finally;}
+
+			vil_hash(input, len, res);
+		}
+		if (opts.memo) memo_store(interp, objv[argi], HASH_AREION512_MD, opts.utf8, res, 32);
+	}
+	Tcl_SetObjResult(interp, digest_obj(res, 32, opts.format));
 
 finally:
 	return code;
@@ -517,11 +565,81 @@ finally:
 	return code;
 }
 
+//>>>
+static OBJCMD(areion_impl_cmd) //<<<
+{
+	(void)cdata;
+	int			code = TCL_OK;
+
+	enum {A_cmd, A_IMPL, A_objc};
+	if (objc > A_objc) {
+		Tcl_WrongNumArgs(interp, A_cmd+1, objv, "?impl|auto?");
+		code = TCL_ERROR;
+		goto finally;
+	}
+
+	if (objc > A_IMPL) {
+		const char*	name = Tcl_GetString(objv[A_IMPL]);
+		size_t		i;
+
+		if (strcmp(name, "auto") == 0) {
+			areion_select(NULL);
+		} else {
+			for (i=0; i<sizeof(areion_impls)/sizeof(areion_impls[0]); i++)
+				if (strcmp(name, areion_impls[i]->name) == 0 && CPU_HAS(areion_impls[i]->requires))
+					break;
+
+			if (i == sizeof(areion_impls)/sizeof(areion_impls[0]))
+				THROW_ERROR_LABEL(finally, code, "areion implementation \"", name, "\" not available");
+
+			areion_select(areion_impls[i]);
+		}
+	}
+
+	// The multi-lane backend where that differs, so the result reinstates the current selection
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(areion_x4 ? areion_x4->name : areion->name, -1));
+
+finally:
+	return code;
+}
+
+//>>>
+static OBJCMD(areion_impls_cmd) //<<<
+{
+	(void)cdata;
+	int			code = TCL_OK;
+
+	enum {A_cmd, A_objc};
+	CHECK_ARGS_LABEL(finally, code, "");
+
+	Tcl_Obj*	res = Tcl_NewListObj(0, NULL);
+	for (size_t i=0; i<sizeof(areion_impls)/sizeof(areion_impls[0]); i++)
+		if (CPU_HAS(areion_impls[i]->requires))
+			Tcl_ListObjAppendElement(NULL, res, Tcl_NewStringObj(areion_impls[i]->name, -1));
+
+	Tcl_SetObjResult(interp, res);
+
+finally:
+	return code;
+}
+
 //>>>
 #endif
 
+TCL_DECLARE_MUTEX(areion_select_mutex)
+
 int areion_init(Tcl_Interp* interp) //<<<
 {
+	static int	selected = 0;
+
+	// Once per process, not per interp: threads may already be hashing with it
+	Tcl_MutexLock(&areion_select_mutex);
+	if (!selected) {
+		areion_select(NULL);
+		selected = 1;
+	}
+	Tcl_MutexUnlock(&areion_select_mutex);
+
 	Tcl_CreateObjCommand(interp, NS "::areion_perm256",	areion_perm256_cmd,	NULL, NULL);
 	Tcl_CreateObjCommand(interp, NS "::areion_perm512",	areion_perm512_cmd,	NULL, NULL);
 	Tcl_CreateObjCommand(interp, NS "::areion256_dm",	areion256_dm_cmd,	NULL, NULL);
@@ -531,6 +649,8 @@ int areion_init(Tcl_Interp* interp) //<<<
 #if TESTMODE
 	Tcl_CreateObjCommand(interp, NS "::_testmode_areion_vlif_init_state",	areion_vlif_init_state_cmd,	NULL, NULL);
 	Tcl_CreateObjCommand(interp, NS "::_testmode_areion_nop",				areion_nop_cmd,				NULL, NULL);
+	Tcl_CreateObjCommand(interp, NS "::_testmode_areion_impl",				areion_impl_cmd,			NULL, NULL);
+	Tcl_CreateObjCommand(interp, NS "::_testmode_areion_impls",				areion_impls_cmd,			NULL, NULL);
 #endif
 
 	return TCL_OK;
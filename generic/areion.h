@@ -1,6 +1,7 @@
 #ifndef _HASH_AREION_H
 #define _HASH_AREION_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -8,14 +9,6 @@
 #define AREION_DEBUG 0
 #endif
 
-#if HAVE_AES_NI
-#	include "areion_x86.h"
-#elif HAVE_AES_NEON
-#	include "areion_neon.h"
-#else
-#	include "areion_software.h"
-#endif
-
 typedef struct {
 	uint8_t		state[32];
 	uint8_t		buffer[32];
@@ -23,6 +16,59 @@ typedef struct {
 	uint32_t	buffer_len;
 } vil_context;
 
+// Areion-512 Merkle-Damgård streaming, from areion.c
+void areion512_md_init(vil_context* ctx);
+void areion512_md_update(vil_context* ctx, const uint8_t* data, uint64_t len);
+void areion512_md_final(vil_context* ctx, uint8_t output[32]);
+
+// Batches of independent messages (or 32 / 64 byte blocks for dm), from areion.c
+void areion_dm_batch(size_t count, const uint8_t* const in[], uint8_t out[][32], size_t block_len);
+void areion512_md_batch(size_t count, const uint8_t* const data[], const uint64_t len[], uint8_t out[][32]);
+
+/*
+ * Each backend (AES-NI, VAES, NEON, bitsliced, T-table, software) lives in its own translation
+ * unit, compiled with the ISA flags it needs, and exports one of these.  The
+ * caller picks the best one the host CPU supports at init time, separately
+ * for the single block functions and the multi-lane ones, and a NULL entry
+ * means the backend doesn't provide that function.
+ */
+struct areion_impl {
+	const char*		name;
+	unsigned int	requires;		// Mask of enum cpu_feature bits this backend needs
+
+	void (*perm256)(uint8_t out[32], const uint8_t in[32]);
+	void (*perm512)(uint8_t out[64], const uint8_t in[64]);
+	void (*dm256)(uint8_t out[32], const uint8_t in[32]);
+	void (*dm512)(uint8_t out[32], const uint8_t in[64]);
+
+	// Areion-512 Merkle-Damgård compression of nblocks consecutive 32 byte blocks into state
+	void (*md_compress)(uint8_t state[32], const uint8_t* blocks, size_t nblocks);
+
+	// 4 independent blocks at once, for the batch forms (without them the batch loops over dm256 / dm512)
+	void (*dm256_x4)(uint8_t out[4][32], const uint8_t* const in[4]);
+	void (*dm512_x4)(uint8_t out[4][32], const uint8_t* const in[4]);
+
+	// md_compress for 4 independent states, lane i absorbing nblocks consecutive blocks from data[i]
+	void (*md_compress_x4)(uint8_t state[4][32], const uint8_t* const data[4], size_t nblocks);
+};
+
+extern const struct areion_impl	areion_impl_x86;
+extern const struct areion_impl	areion_impl_vaes;
+extern const struct areion_impl	areion_impl_neon;
+extern const struct areion_impl	areion_impl_bitsliced;
+extern const struct areion_impl	areion_impl_ttable;
+extern const struct areion_impl	areion_impl_software;
+
+static inline void aerion_trunc(const uint64_t input[8], uint64_t output[4]) //<<<
+{
+	output[0] = input[1];
+	output[1] = input[3];
+	output[2] = input[4];
+	output[3] = input[6];
+}
+
+//>>>
+
 #endif
 
 // vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
@@ -0,0 +1,623 @@
+/*
+ * Constant time software Areion backend.  The AES rounds use the bitsliced
+ * representation from BearSSL's aes_ct64: a set of 8 64 bit words holds 4
+ * AES blocks, one bit plane per word, and the S-box is evaluated as the
+ * Boyar-Peralta boolean circuit, so there are no secret dependent table
+ * lookups or branches.
+ *
+ * Set i holds word xi of 4 independent Areion states, so each aesenc of
+ * the round functions is one operation on a whole set.  The single state
+ * functions use one of the slots, the multi-lane ones all 4.  The states
+ * stay bitsliced for the whole permutation (and across blocks in
+ * md_compress_x4), only converting on the way in and out.
+ *
+ * The bitslicing, S-box circuit, ShiftRows and MixColumns are taken from
+ * BearSSL (aes_ct64.c, aes_ct64_enc.c):
+ *
+ * Copyright (c) 2016 Thomas Pornin <pornin@bolet.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "areion.h"
+
+/*
+ * The Areion round constants (as the x86 backend's RC0) in the bitsliced
+ * layout, the same constant in all 4 slots.  RC1 is zero.
+ */
+static const uint64_t bs_rc[15][8] = {
+	{0x0FFFFFF0000F0F00ULL, 0x00FFFF00F0FF0FF0ULL, 0xFF00F000000000FFULL, 0x0000F0F0FFF0F0F0ULL, 0x00F0F0FF000F0F00ULL, 0xF000FF0FF00F00F0ULL, 0x0000000FF00F0F0FULL, 0x0F000F0000F0FF00ULL},
+	{0x0F00FF000F00000FULL, 0x00000FFF00F0F000ULL, 0xF00F0FFF000F0000ULL, 0x0FFFFFFFF0FF00FFULL, 0x00000F00FFF00FF0ULL, 0xFF0F00F0FFFFF000ULL, 0x000F000F00FF0F00ULL, 0xF00F0F0000F00FFFULL},
+	{0xF000000FFF000FF0ULL, 0x00F000000FF0FFF0ULL, 0xF0FF00F000FFFFFFULL, 0x0FF0F00F000F00FFULL, 0x0FFF0FF00F000F00ULL, 0x0FFFF00FF0F0FF0FULL, 0xF0000FFF00F0FFFFULL, 0x00F00F0F0000F0F0ULL},
+	{0x0FFF000FF0FFFFFFULL, 0x00F0000F0000F00FULL, 0x00FFFFFF00F0FFFFULL, 0x0FF0FF00F00F0F00ULL, 0x00FF0F000FF0FFFFULL, 0x00FFFF00F000F0F0ULL, 0xFF000F0F0FF00F00ULL, 0xFF0FF0F000F0FFF0ULL},
+	{0x0FF00FFFFFFFFF00ULL, 0xF000F00F0FF00FF0ULL, 0x0000F00FF00F00FFULL, 0x0F0F0F0F0FF0FF0FULL, 0xF0FFFFFFFF0FFF00ULL, 0x00000FF00F0F00FFULL, 0x00F00F0FFF00F000ULL, 0xFFFF000FFF0FF0FFULL},
+	{0xF000F0F00FF0FFF0ULL, 0xF00F0F0FFFFFFF0FULL, 0xF000F00F0FFF0FFFULL, 0xF0FFFF000FFFF0F0ULL, 0x0FF0FF00FF0FFF0FULL, 0xF0FFF0FFF0FF0FF0ULL, 0x0F0FF0F0FF0FF0F0ULL, 0x0FF0F0F00FF0FFFFULL},
+	{0x0F0F00FF0FF0FFFFULL, 0xF00F00000F0000FFULL, 0x00F0FF000F0FF0FFULL, 0xF000FF000FFF0F00ULL, 0xFF0FF00FFFF00F0FULL, 0xFFFFFFF00F0F000FULL, 0x0F00F0000F0FF0FFULL, 0xFF0F00FFF0F00F0FULL},
+	{0x000FFF000FF000F0ULL, 0x00F0FFF0F00F0FF0ULL, 0x00FFFF0FF0FF0FF0ULL, 0x0F00FF00F0F0F000ULL, 0x0FFFF0FF0000000FULL, 0x00F00F0FF00FFF00ULL, 0x0F000F0F0F0F0F00ULL, 0xF0000FF00F0F00FFULL},
+	{0x00F00FF00F00F0F0ULL, 0x000F0F0FF00FFFF0ULL, 0xFFF000FFFFFF0FF0ULL, 0x00F0F00FFF000FFFULL, 0x0F0FFFF0FFFF0F0FULL, 0xFF0F0000FFFFFF00ULL, 0x0F0FF000F0F00F0FULL, 0xFF000FFFF00FF0F0ULL},
+	{0xF0F0FF00F00F00FFULL, 0x0FFFF00F0F000F00ULL, 0x00000FF0F0F00FFFULL, 0x00F0F00FFF0FFFF0ULL, 0xF0F00FFF000FF0FFULL, 0xF0F0000000F00F0FULL, 0xF0FF00FFFF0FFF00ULL, 0x0F0FF000F0F00F0FULL},
+	{0x00F000F0F00FFFF0ULL, 0x0F000F0000000FF0ULL, 0xF0F00000F00F0000ULL, 0xFF0F00000000F000ULL, 0xF000FFF0F0F0FF0FULL, 0x0F0FFF0F0FF0F0FFULL, 0x00F00FFFFF00000FULL, 0xF0F00FF0F0FF000FULL},
+	{0x0000FFF0F0000F00ULL, 0xF0F00F0F00000F0FULL, 0x00F0000000F00F0FULL, 0xFFF00FFFFFFFFF0FULL, 0x0F000FFFFFFFF0F0ULL, 0x0F0F00FFFF000FF0ULL, 0xF00FFFF0F0F00F00ULL, 0xFFF00F0000F00FF0ULL},
+	{0x00FF00FF00FFF0FFULL, 0x00F0FF00FFFFFF0FULL, 0xF0FFFFF0F0F00F0FULL, 0xF00FFF00FF0FFF00ULL, 0x0FFFFFFF00F00F00ULL, 0xFF0F000F00F00F0FULL, 0xF0F0000000FF00F0ULL, 0x0FFFF0000F00F0F0ULL},
+	{0x0F00F0FFF0FF00F0ULL, 0x00FFF000F00FF0F0ULL, 0x0FF0F0FFFFF0000FULL, 0xF00FF000FF0FF000ULL, 0xFF0000FF0F00F0FFULL, 0xF0FFFF00F0FF0FF0ULL, 0xFFF00FFF0F00FFF0ULL, 0x00FFF000000FF0FFULL},
+	{0xFFF0000F00F00000ULL, 0xFF0F00FF0000F0FFULL, 0xF0F000000F00000FULL, 0x000FFFFFF0F000F0ULL, 0xF0F00000FFFF000FULL, 0x0F0F0F0F00F0F0FFULL, 0xFFF0FFF00000FFF0ULL, 0x00000FFFF000000FULL},
+};
+
+// AES in the bitsliced layout <<<
+static void bs_sbox(uint64_t q[8]) //<<<
+{
+	uint64_t	x0, x1, x2, x3, x4, x5, x6, x7;
+	uint64_t	y1, y2, y3, y4, y5, y6, y7, y8, y9;
+	uint64_t	y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+	uint64_t	y20, y21;
+	uint64_t	z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+	uint64_t	z10, z11, z12, z13, z14, z15, z16, z17;
+	uint64_t	t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+	uint64_t	t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+	uint64_t	t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+	uint64_t	t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+	uint64_t	t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+	uint64_t	t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+	uint64_t	t60, t61, t62, t63, t64, t65, t66, t67;
+	uint64_t	s0, s1, s2, s3, s4, s5, s6, s7;
+
+	x0 = q[7];
+	x1 = q[6];
+	x2 = q[5];
+	x3 = q[4];
+	x4 = q[3];
+	x5 = q[2];
+	x6 = q[1];
+	x7 = q[0];
+
+	// Top linear transformation
+	y14 = x3 ^ x5;
+	y13 = x0 ^ x6;
+	y9  = x0 ^ x3;
+	y8  = x0 ^ x5;
+	t0  = x1 ^ x2;
+	y1  = t0 ^ x7;
+	y4  = y1 ^ x3;
+	y12 = y13 ^ y14;
+	y2  = y1 ^ x0;
+	y5  = y1 ^ x6;
+	y3  = y5 ^ y8;
+	t1  = x4 ^ y12;
+	y15 = t1 ^ x5;
+	y20 = t1 ^ x1;
+	y6  = y15 ^ x7;
+	y10 = y15 ^ t0;
+	y11 = y20 ^ y9;
+	y7  = x7 ^ y11;
+	y17 = y10 ^ y11;
+	y19 = y10 ^ y8;
+	y16 = t0 ^ y11;
+	y21 = y13 ^ y16;
+	y18 = x0 ^ y16;
+
+	// Non-linear section
+	t2  = y12 & y15;
+	t3  = y3 & y6;
+	t4  = t3 ^ t2;
+	t5  = y4 & x7;
+	t6  = t5 ^ t2;
+	t7  = y13 & y16;
+	t8  = y5 & y1;
+	t9  = t8 ^ t7;
+	t10 = y2 & y7;
+	t11 = t10 ^ t7;
+	t12 = y9 & y11;
+	t13 = y14 & y17;
+	t14 = t13 ^ t12;
+	t15 = y8 & y10;
+	t16 = t15 ^ t12;
+	t17 = t4 ^ t14;
+	t18 = t6 ^ t16;
+	t19 = t9 ^ t14;
+	t20 = t11 ^ t16;
+	t21 = t17 ^ y20;
+	t22 = t18 ^ y19;
+	t23 = t19 ^ y21;
+	t24 = t20 ^ y18;
+
+	t25 = t21 ^ t22;
+	t26 = t21 & t23;
+	t27 = t24 ^ t26;
+	t28 = t25 & t27;
+	t29 = t28 ^ t22;
+	t30 = t23 ^ t24;
+	t31 = t22 ^ t26;
+	t32 = t31 & t30;
+	t33 = t32 ^ t24;
+	t34 = t23 ^ t33;
+	t35 = t27 ^ t33;
+	t36 = t24 & t35;
+	t37 = t36 ^ t34;
+	t38 = t27 ^ t36;
+	t39 = t29 & t38;
+	t40 = t25 ^ t39;
+
+	t41 = t40 ^ t37;
+	t42 = t29 ^ t33;
+	t43 = t29 ^ t40;
+	t44 = t33 ^ t37;
+	t45 = t42 ^ t41;
+	z0  = t44 & y15;
+	z1  = t37 & y6;
+	z2  = t33 & x7;
+	z3  = t43 & y16;
+	z4  = t40 & y1;
+	z5  = t29 & y7;
+	z6  = t42 & y11;
+	z7  = t45 & y17;
+	z8  = t41 & y10;
+	z9  = t44 & y12;
+	z10 = t37 & y3;
+	z11 = t33 & y4;
+	z12 = t43 & y13;
+	z13 = t40 & y5;
+	z14 = t29 & y2;
+	z15 = t42 & y9;
+	z16 = t45 & y14;
+	z17 = t41 & y8;
+
+	// Bottom linear transformation
+	t46 = z15 ^ z16;
+	t47 = z10 ^ z11;
+	t48 = z5 ^ z13;
+	t49 = z9 ^ z10;
+	t50 = z2 ^ z12;
+	t51 = z2 ^ z5;
+	t52 = z7 ^ z8;
+	t53 = z0 ^ z3;
+	t54 = z6 ^ z7;
+	t55 = z16 ^ z17;
+	t56 = z12 ^ t48;
+	t57 = t50 ^ t53;
+	t58 = z4 ^ t46;
+	t59 = z3 ^ t54;
+	t60 = t46 ^ t57;
+	t61 = z14 ^ t57;
+	t62 = t52 ^ t58;
+	t63 = t49 ^ t58;
+	t64 = z4 ^ t59;
+	t65 = t61 ^ t62;
+	t66 = z1 ^ t63;
+	s0  = t59 ^ t63;
+	s6  = t56 ^ ~t62;
+	s7  = t48 ^ ~t60;
+	t67 = t64 ^ t65;
+	s3  = t53 ^ t66;
+	s4  = t51 ^ t66;
+	s5  = t47 ^ t65;
+	s1  = t64 ^ ~s3;
+	s2  = t55 ^ ~t67;
+
+	q[7] = s0;
+	q[6] = s1;
+	q[5] = s2;
+	q[4] = s3;
+	q[3] = s4;
+	q[2] = s5;
+	q[1] = s6;
+	q[0] = s7;
+}
+
+//>>>
+static inline void bs_shift_rows(uint64_t q[8]) //<<<
+{
+	for (int i=0; i<8; i++) {
+		const uint64_t	x = q[i];
+
+		q[i] = (x & 0x000000000000FFFFULL)
+			| ((x & 0x00000000FFF00000ULL) >> 4)
+			| ((x & 0x00000000000F0000ULL) << 12)
+			| ((x & 0x0000FF0000000000ULL) >> 8)
+			| ((x & 0x000000FF00000000ULL) << 8)
+			| ((x & 0xF000000000000000ULL) >> 12)
+			| ((x & 0x0FFF000000000000ULL) << 4);
+	}
+}
+
+//>>>
+static inline uint64_t rotr32(uint64_t x) //<<<
+{
+	return (x << 32) | (x >> 32);
+}
+
+//>>>
+static inline void bs_mix_columns(uint64_t q[8]) //<<<
+{
+	const uint64_t	q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+	const uint64_t	q4 = q[4], q5 = q[5], q6 = q[6], q7 = q[7];
+	const uint64_t	r0 = (q0 >> 16) | (q0 << 48);
+	const uint64_t	r1 = (q1 >> 16) | (q1 << 48);
+	const uint64_t	r2 = (q2 >> 16) | (q2 << 48);
+	const uint64_t	r3 = (q3 >> 16) | (q3 << 48);
+	const uint64_t	r4 = (q4 >> 16) | (q4 << 48);
+	const uint64_t	r5 = (q5 >> 16) | (q5 << 48);
+	const uint64_t	r6 = (q6 >> 16) | (q6 << 48);
+	const uint64_t	r7 = (q7 >> 16) | (q7 << 48);
+
+	q[0] = q7 ^ r7 ^ r0 ^ rotr32(q0 ^ r0);
+	q[1] = q0 ^ r0 ^ q7 ^ r7 ^ r1 ^ rotr32(q1 ^ r1);
+	q[2] = q1 ^ r1 ^ r2 ^ rotr32(q2 ^ r2);
+	q[3] = q2 ^ r2 ^ q7 ^ r7 ^ r3 ^ rotr32(q3 ^ r3);
+	q[4] = q3 ^ r3 ^ q7 ^ r7 ^ r4 ^ rotr32(q4 ^ r4);
+	q[5] = q4 ^ r4 ^ r5 ^ rotr32(q5 ^ r5);
+	q[6] = q5 ^ r5 ^ r6 ^ rotr32(q6 ^ r6);
+	q[7] = q6 ^ r6 ^ r7 ^ rotr32(q7 ^ r7);
+}
+
+//>>>
+static inline void bs_xor(uint64_t dst[8], const uint64_t src[8]) //<<<
+{
+	for (int i=0; i<8; i++)
+		dst[i] ^= src[i];
+}
+
+//>>>
+//>>>
+// Conversion to and from the bitsliced layout <<<
+static void bs_ortho(uint64_t q[8]) //<<<
+{
+#define SWAPN(cl, ch, s, x, y) do { \
+	const uint64_t	a = (x), b = (y); \
+	(x) = (a & (cl)) | ((b & (cl)) << (s)); \
+	(y) = ((a & (ch)) >> (s)) | (b & (ch)); \
+} while (0)
+#define SWAP2(x, y)	SWAPN(0x5555555555555555ULL, 0xAAAAAAAAAAAAAAAAULL, 1, x, y)
+#define SWAP4(x, y)	SWAPN(0x3333333333333333ULL, 0xCCCCCCCCCCCCCCCCULL, 2, x, y)
+#define SWAP8(x, y)	SWAPN(0x0F0F0F0F0F0F0F0FULL, 0xF0F0F0F0F0F0F0F0ULL, 4, x, y)
+
+	SWAP2(q[0], q[1]);
+	SWAP2(q[2], q[3]);
+	SWAP2(q[4], q[5]);
+	SWAP2(q[6], q[7]);
+
+	SWAP4(q[0], q[2]);
+	SWAP4(q[1], q[3]);
+	SWAP4(q[4], q[6]);
+	SWAP4(q[5], q[7]);
+
+	SWAP8(q[0], q[4]);
+	SWAP8(q[1], q[5]);
+	SWAP8(q[2], q[6]);
+	SWAP8(q[3], q[7]);
+
+#undef SWAP8
+#undef SWAP4
+#undef SWAP2
+#undef SWAPN
+}
+
+//>>>
+static inline uint32_t le32(const uint8_t* p) //<<<
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+//>>>
+static inline void put_le32(uint8_t* p, uint32_t w) //<<<
+{
+	p[0] = (uint8_t) w;
+	p[1] = (uint8_t)(w >> 8);
+	p[2] = (uint8_t)(w >> 16);
+	p[3] = (uint8_t)(w >> 24);
+}
+
+//>>>
+// Bitslice the 16 bytes at in[slot] + ofs of each of the 4 slots into q
+static void bs_load(uint64_t q[8], const uint8_t* const in[4], size_t ofs) //<<<
+{
+	for (int slot=0; slot<4; slot++) {
+		const uint8_t*	p = in[slot] + ofs;
+		uint64_t		x0 = le32(p), x1 = le32(p + 4), x2 = le32(p + 8), x3 = le32(p + 12);
+
+		x0 |= x0 << 16;		x1 |= x1 << 16;		x2 |= x2 << 16;		x3 |= x3 << 16;
+		x0 &= 0x0000FFFF0000FFFFULL;
+		x1 &= 0x0000FFFF0000FFFFULL;
+		x2 &= 0x0000FFFF0000FFFFULL;
+		x3 &= 0x0000FFFF0000FFFFULL;
+		x0 |= x0 << 8;		x1 |= x1 << 8;		x2 |= x2 << 8;		x3 |= x3 << 8;
+		x0 &= 0x00FF00FF00FF00FFULL;
+		x1 &= 0x00FF00FF00FF00FFULL;
+		x2 &= 0x00FF00FF00FF00FFULL;
+		x3 &= 0x00FF00FF00FF00FFULL;
+		q[slot]     = x0 | (x2 << 8);
+		q[slot + 4] = x1 | (x3 << 8);
+	}
+	bs_ortho(q);
+}
+
+//>>>
+// The inverse of bs_load, to out[slot] + ofs
+static void bs_store(uint8_t* const out[4], size_t ofs, const uint64_t src[8]) //<<<
+{
+	uint64_t	q[8];
+
+	memcpy(q, src, sizeof(q));
+	bs_ortho(q);
+	for (int slot=0; slot<4; slot++) {
+		uint8_t*	p = out[slot] + ofs;
+		uint64_t	x0 = q[slot] & 0x00FF00FF00FF00FFULL;
+		uint64_t	x1 = q[slot + 4] & 0x00FF00FF00FF00FFULL;
+		uint64_t	x2 = (q[slot] >> 8) & 0x00FF00FF00FF00FFULL;
+		uint64_t	x3 = (q[slot + 4] >> 8) & 0x00FF00FF00FF00FFULL;
+
+		x0 |= x0 >> 8;		x1 |= x1 >> 8;		x2 |= x2 >> 8;		x3 |= x3 >> 8;
+		x0 &= 0x0000FFFF0000FFFFULL;
+		x1 &= 0x0000FFFF0000FFFFULL;
+		x2 &= 0x0000FFFF0000FFFFULL;
+		x3 &= 0x0000FFFF0000FFFFULL;
+		put_le32(p,      (uint32_t)x0 | (uint32_t)(x0 >> 16));
+		put_le32(p + 4,  (uint32_t)x1 | (uint32_t)(x1 >> 16));
+		put_le32(p + 8,  (uint32_t)x2 | (uint32_t)(x2 >> 16));
+		put_le32(p + 12, (uint32_t)x3 | (uint32_t)(x3 >> 16));
+	}
+}
+
+//>>>
+//>>>
+// Areion permutations on 4 states <<<
+static inline void sb_sr(uint64_t q[8]) //<<<
+{
+	bs_sbox(q);
+	bs_shift_rows(q);
+}
+
+//>>>
+/*
+ * x1 = aesenc(aesenc(x0, RC0), x1)
+ * x0 = aesenclast(x0, RC1)
+ */
+static void bs_round_256(uint64_t x0[8], uint64_t x1[8], int i) //<<<
+{
+	uint64_t	t[8];
+
+	sb_sr(x0);
+	memcpy(t, x0, sizeof(t));
+	bs_mix_columns(t);
+	bs_xor(t, bs_rc[i]);
+	sb_sr(t);
+	bs_mix_columns(t);
+	bs_xor(x1, t);
+}
+
+//>>>
+static void bs_perm256(uint64_t x[2][8]) //<<<
+{
+	for (int i=0; i<10; i+=2) {
+		bs_round_256(x[0], x[1], i);
+		bs_round_256(x[1], x[0], i+1);
+	}
+}
+
+//>>>
+/*
+ * x1 = aesenc(x0, x1)
+ * x3 = aesenc(x2, x3)
+ * x0 = aesenclast(x0, RC1)
+ * x2 = aesenc(aesenclast(x2, RC0), RC1)
+ */
+static void bs_round_512(uint64_t x0[8], uint64_t x1[8], uint64_t x2[8], uint64_t x3[8], int i) //<<<
+{
+	uint64_t	t[8];
+
+	sb_sr(x0);
+	memcpy(t, x0, sizeof(t));
+	bs_mix_columns(t);
+	bs_xor(x1, t);
+
+	sb_sr(x2);
+	memcpy(t, x2, sizeof(t));
+	bs_mix_columns(t);
+	bs_xor(x3, t);
+
+	bs_xor(x2, bs_rc[i]);
+	sb_sr(x2);
+	bs_mix_columns(x2);
+}
+
+//>>>
+// Leaves the result in x3, x0, x1, x2 order like perm512
+static void bs_perm512(uint64_t x[4][8]) //<<<
+{
+	for (int i=0; i<12; i+=4) {
+		bs_round_512(x[0], x[1], x[2], x[3], i);
+		bs_round_512(x[1], x[2], x[3], x[0], i+1);
+		bs_round_512(x[2], x[3], x[0], x[1], i+2);
+		bs_round_512(x[3], x[0], x[1], x[2], i+3);
+	}
+	bs_round_512(x[0], x[1], x[2], x[3], 12);
+	bs_round_512(x[1], x[2], x[3], x[0], 13);
+	bs_round_512(x[2], x[3], x[0], x[1], 14);
+}
+
+//>>>
+/*
+ * Davies-Meyer feed forward of bs_perm512 on the original input o, truncated
+ * to 64 bit words 1, 3, 4 and 6 as aerion_trunc.  In the bitsliced layout
+ * each 16 bit row of a bit plane holds 4 bits (one per slot) for each
+ * column, and the 64 bit halves of a block are columns 0-1 and 2-3.
+ */
+static void bs_dm512_trunc(uint64_t h[2][8], uint64_t x[4][8], uint64_t o[4][8]) //<<<
+{
+	const uint64_t	lo = 0x00FF00FF00FF00FFULL;		// Columns 0 and 1 of each row
+
+	for (int b=0; b<8; b++) {
+		const uint64_t	a0 = x[3][b] ^ o[0][b];
+		const uint64_t	a1 = x[0][b] ^ o[1][b];
+		const uint64_t	a2 = x[1][b] ^ o[2][b];
+		const uint64_t	a3 = x[2][b] ^ o[3][b];
+
+		h[0][b] = ((a0 >> 8) & lo) | (a1 & ~lo);
+		h[1][b] = (a2 & lo) | ((a3 << 8) & ~lo);
+	}
+}
+
+//>>>
+//>>>
+// Backend functions <<<
+static void bs_dm256_x4(uint8_t out[4][32], const uint8_t* const in[4]) //<<<
+{
+	uint8_t* const	dst[4] = {out[0], out[1], out[2], out[3]};
+	uint64_t		x[2][8], o[2][8];
+
+	bs_load(x[0], in, 0);
+	bs_load(x[1], in, 16);
+	memcpy(o, x, sizeof(o));
+
+	bs_perm256(x);
+
+	bs_xor(x[0], o[0]);
+	bs_xor(x[1], o[1]);
+	bs_store(dst, 0,  x[0]);
+	bs_store(dst, 16, x[1]);
+}
+
+//>>>
+static void bs_dm512_x4(uint8_t out[4][32], const uint8_t* const in[4]) //<<<
+{
+	uint8_t* const	dst[4] = {out[0], out[1], out[2], out[3]};
+	uint64_t		x[4][8], o[4][8], h[2][8];
+
+	for (int i=0; i<4; i++)
+		bs_load(x[i], in, 16*i);
+	memcpy(o, x, sizeof(o));
+
+	bs_perm512(x);
+
+	bs_dm512_trunc(h, x, o);
+	bs_store(dst, 0,  h[0]);
+	bs_store(dst, 16, h[1]);
+}
+
+//>>>
+static void bs_md_compress_x4(uint8_t state[4][32], const uint8_t* const data[4], size_t nblocks) //<<<
+{
+	uint8_t* const	dst[4] = {state[0], state[1], state[2], state[3]};
+	uint64_t		h[2][8];
+
+	// The chaining values stay bitsliced from one block to the next
+	bs_load(h[0], (const uint8_t* const*)dst, 0);
+	bs_load(h[1], (const uint8_t* const*)dst, 16);
+
+	for (size_t ofs=0; ofs < nblocks*32; ofs += 32) {
+		uint64_t	x[4][8], o[4][8];
+
+		bs_load(x[0], data, ofs);
+		bs_load(x[1], data, ofs + 16);
+		memcpy(x[2], h, sizeof(h));
+		memcpy(o, x, sizeof(o));
+
+		bs_perm512(x);
+
+		bs_dm512_trunc(h, x, o);
+	}
+
+	bs_store(dst, 0,  h[0]);
+	bs_store(dst, 16, h[1]);
+}
+
+//>>>
+static void bs_perm256_1(uint8_t out[32], const uint8_t in[32]) //<<<
+{
+	const uint8_t* const	src[4] = {in, in, in, in};
+	uint8_t					tmp[4][32];
+	uint8_t* const			dst[4] = {tmp[0], tmp[1], tmp[2], tmp[3]};
+	uint64_t				x[2][8];
+
+	bs_load(x[0], src, 0);
+	bs_load(x[1], src, 16);
+	bs_perm256(x);
+	bs_store(dst, 0,  x[0]);
+	bs_store(dst, 16, x[1]);
+	memcpy(out, tmp[0], 32);
+}
+
+//>>>
+static void bs_perm512_1(uint8_t out[64], const uint8_t in[64]) //<<<
+{
+	const uint8_t* const	src[4] = {in, in, in, in};
+	uint8_t					tmp[4][64];
+	uint8_t* const			dst[4] = {tmp[0], tmp[1], tmp[2], tmp[3]};
+	uint64_t				x[4][8];
+
+	for (int i=0; i<4; i++)
+		bs_load(x[i], src, 16*i);
+	bs_perm512(x);
+	bs_store(dst, 0,  x[3]);
+	bs_store(dst, 16, x[0]);
+	bs_store(dst, 32, x[1]);
+	bs_store(dst, 48, x[2]);
+	memcpy(out, tmp[0], 64);
+}
+
+//>>>
+static void bs_dm256_1(uint8_t out[32], const uint8_t in[32]) //<<<
+{
+	const uint8_t* const	src[4] = {in, in, in, in};
+	uint8_t					tmp[4][32];
+
+	bs_dm256_x4(tmp, src);
+	memcpy(out, tmp[0], 32);
+}
+
+//>>>
+static void bs_dm512_1(uint8_t out[32], const uint8_t in[64]) //<<<
+{
+	const uint8_t* const	src[4] = {in, in, in, in};
+	uint8_t					tmp[4][32];
+
+	bs_dm512_x4(tmp, src);
+	memcpy(out, tmp[0], 32);
+}
+
+//>>>
+static void bs_md_compress_1(uint8_t state[32], const uint8_t* blocks, size_t nblocks) //<<<
+{
+	const uint8_t* const	src[4] = {blocks, blocks, blocks, blocks};
+	uint8_t					tmp[4][32];
+
+	for (int slot=0; slot<4; slot++)
+		memcpy(tmp[slot], state, 32);
+	bs_md_compress_x4(tmp, src, nblocks);
+	memcpy(state, tmp[0], 32);
+}
+
+//>>>
+//>>>
+
+const struct areion_impl areion_impl_bitsliced = {
+	.name			= "bitsliced",
+	.requires		= 0,
+	.perm256		= bs_perm256_1,
+	.perm512		= bs_perm512_1,
+	.dm256			= bs_dm256_1,
+	.dm512			= bs_dm512_1,
+	.md_compress	= bs_md_compress_1,
+	.dm256_x4		= bs_dm256_x4,
+	.dm512_x4		= bs_dm512_x4,
+	.md_compress_x4	= bs_md_compress_x4,
+};
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
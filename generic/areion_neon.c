@@ -0,0 +1,105 @@
+/*
+ * ARM NEON Areion backend.  Compiled with -march=armv8-a+crypto, only called
+ * when the host CPU reports the AES crypto extensions.
+ */
+
+#include "areion.h"
+#include "cpu.h"
+
+#if defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO)
+#include "areion_neon.h"
+
+/*
+ * The Davies-Meyer feed forward of perm512's x3, x0, x1, x2 output l on the
+ * input o, truncated to 64 bit words 1, 3, 4 and 6 by recombining halves
+ * rather than a round trip through memory
+ */
+#define DM512_TRUNC(l, o, lo, hi) do { \
+	lo = vcombine_u8(vget_high_u8(veorq_u8(l[3], o[0])), vget_high_u8(veorq_u8(l[0], o[1]))); \
+	hi = vcombine_u8(vget_low_u8(veorq_u8(l[1], o[2])),  vget_low_u8(veorq_u8(l[2], o[3]))); \
+} while (0)
+
+static void neon_perm256(uint8_t out[32], const uint8_t in[32]) //<<<
+{
+	uint8x16_t	x0 = vld1q_u8(in);
+	uint8x16_t	x1 = vld1q_u8(in + 16);
+	perm256(x0, x1);
+	vst1q_u8(out,      x0);
+	vst1q_u8(out + 16, x1);
+}
+
+//>>>
+static void neon_perm512(uint8_t out[64], const uint8_t in[64]) //<<<
+{
+	uint8x16_t	x0 = vld1q_u8(in);
+	uint8x16_t	x1 = vld1q_u8(in + 16);
+	uint8x16_t	x2 = vld1q_u8(in + 32);
+	uint8x16_t	x3 = vld1q_u8(in + 48);
+	perm512(x0, x1, x2, x3);
+	vst1q_u8(out,      x3);
+	vst1q_u8(out + 16, x0);
+	vst1q_u8(out + 32, x1);
+	vst1q_u8(out + 48, x2);
+}
+
+//>>>
+static void neon_dm256(uint8_t out[32], const uint8_t in[32]) //<<<
+{
+	uint8x16_t	x0 = vld1q_u8(in);
+	uint8x16_t	x1 = vld1q_u8(in + 16);
+	uint8x16_t	orig_x0 = x0;
+	uint8x16_t	orig_x1 = x1;
+	perm256(x0, x1);
+	x0 = veorq_u8(x0, orig_x0);
+	x1 = veorq_u8(x1, orig_x1);
+	vst1q_u8(out,      x0);
+	vst1q_u8(out + 16, x1);
+}
+
+//>>>
+static void neon_dm512(uint8_t out[32], const uint8_t in[64]) //<<<
+{
+	const uint8x16_t	o[4] = {vld1q_u8(in), vld1q_u8(in + 16), vld1q_u8(in + 32), vld1q_u8(in + 48)};
+	uint8x16_t			x[4] = {o[0], o[1], o[2], o[3]};
+	uint8x16_t			lo, hi;
+
+	perm512(x[0], x[1], x[2], x[3]);
+
+	DM512_TRUNC(x, o, lo, hi);
+	vst1q_u8(out,      lo);
+	vst1q_u8(out + 16, hi);
+}
+
+//>>>
+static void neon_md_compress(uint8_t state[32], const uint8_t* blocks, size_t nblocks) //<<<
+{
+	// The chaining value stays in registers from one block to the next
+	uint8x16_t	h[2] = {vld1q_u8(state), vld1q_u8(state + 16)};
+
+	for (; nblocks; nblocks--, blocks += 32) {
+		const uint8x16_t	o[4] = {vld1q_u8(blocks), vld1q_u8(blocks + 16), h[0], h[1]};
+		uint8x16_t			x[4] = {o[0], o[1], o[2], o[3]};
+
+		perm512(x[0], x[1], x[2], x[3]);
+
+		DM512_TRUNC(x, o, h[0], h[1]);
+	}
+
+	vst1q_u8(state,      h[0]);
+	vst1q_u8(state + 16, h[1]);
+}
+
+//>>>
+
+const struct areion_impl areion_impl_neon = {
+	.name			= "neon",
+	.requires		= CPU_NEON_AES,
+	.perm256		= neon_perm256,
+	.perm512		= neon_perm512,
+	.dm256			= neon_dm256,
+	.dm512			= neon_dm512,
+	.md_compress	= neon_md_compress,
+};
+#endif
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
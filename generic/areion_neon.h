@@ -47,7 +47,7 @@ static void debug_print_uint8x16_t(const char* name, uint8x16_t val)
  * X86 uses: RC0(i) = _mm_setr_epi32(RC[(i)*4+3], RC[(i)*4+2], RC[(i)*4+1], RC[(i)*4+0])
  * This means constants are loaded in reverse order within each round
  */
-const uint32_t RC[15*4] = {
+static const uint32_t RC[15*4] = {
 	0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344,
 	0xa4093822, 0x299f31d0, 0x082efa98, 0xec4e6c89,
 	0x452821e6, 0x38d01377, 0xbe5466cf, 0x34e90c6c,
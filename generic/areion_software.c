@@ -0,0 +1,89 @@
+/*
+ * Portable Areion backend, used when the host has neither AES-NI nor the
+ * NEON crypto extensions.
+ */
+
+#include "areion.h"
+#include "areion_software.h"
+
+static void sw_perm256(uint8_t out[32], const uint8_t in[32]) //<<<
+{
+	uint8_t	x0[16], x1[16];
+
+	memcpy(x0, in,      16);
+	memcpy(x1, in + 16, 16);
+	perm256(x0, x1);
+	memcpy(out,      x0, 16);
+	memcpy(out + 16, x1, 16);
+}
+
+//>>>
+static void sw_perm512(uint8_t out[64], const uint8_t in[64]) //<<<
+{
+	permute_areion_512(out, in);
+}
+
+//>>>
+static void sw_dm256(uint8_t out[32], const uint8_t in[32]) //<<<
+{
+	sw_perm256(out, in);
+
+	for (int i=0; i<32; i++)
+		out[i] ^= in[i];
+}
+
+//>>>
+/*
+ * Davies-Meyer feed forward of perm512's x3, x0, x1, x2 output x on the block
+ * and chaining value h, truncated to 64 bit words 1, 3, 4 and 6 in place in h
+ */
+static inline void sw_dm512_trunc(uint8_t h[32], uint8_t x[4][16], const uint8_t block[32]) //<<<
+{
+	for (int i=0; i<8; i++) {
+		const uint8_t	w4 = x[1][i] ^ h[i];
+		const uint8_t	w6 = x[2][i] ^ h[16 + i];
+
+		h[i]      = x[3][8 + i] ^ block[8 + i];
+		h[8 + i]  = x[0][8 + i] ^ block[24 + i];
+		h[16 + i] = w4;
+		h[24 + i] = w6;
+	}
+}
+
+//>>>
+static void sw_dm512(uint8_t out[32], const uint8_t in[64]) //<<<
+{
+	uint8_t	x[4][16];
+
+	memcpy(x, in, 64);
+	memcpy(out, in + 32, 32);
+	perm512(x[0], x[1], x[2], x[3]);
+	sw_dm512_trunc(out, x, in);
+}
+
+//>>>
+static void sw_md_compress(uint8_t state[32], const uint8_t* blocks, size_t nblocks) //<<<
+{
+	uint8_t	x[4][16];
+
+	for (; nblocks; nblocks--, blocks += 32) {
+		memcpy(x[0], blocks, 32);
+		memcpy(x[2], state,  32);
+		perm512(x[0], x[1], x[2], x[3]);
+		sw_dm512_trunc(state, x, blocks);
+	}
+}
+
+//>>>
+
+const struct areion_impl areion_impl_software = {
+	.name			= "software",
+	.requires		= 0,
+	.perm256		= sw_perm256,
+	.perm512		= sw_perm512,
+	.dm256			= sw_dm256,
+	.dm512			= sw_dm512,
+	.md_compress	= sw_md_compress,
+};
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
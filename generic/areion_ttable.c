@@ -0,0 +1,302 @@
+/*
+ * T-table software Areion backend: each aesenc is 16 lookups into 32 bit
+ * tables that combine SubBytes and MixColumns, with ShiftRows folded into
+ * which byte feeds which column.  Much faster than the byte at a time
+ * software backend, but the lookups are indexed by state bytes, so its
+ * timing depends on the data through the cache.  Only for non-adversarial
+ * uses (cache keys and the like on hosts without AES instructions), so it
+ * is never chosen automatically unless the build opts in with
+ * AREION_TTABLE.
+ *
+ * The state is kept as little endian 32 bit columns, so the results match
+ * the x86 backend on hosts of either byte order.
+ */
+
+#include "areion.h"
+
+#define SBOX(F) \
+	F(0x63), F(0x7c), F(0x77), F(0x7b), F(0xf2), F(0x6b), F(0x6f), F(0xc5), F(0x30), F(0x01), F(0x67), F(0x2b), F(0xfe), F(0xd7), F(0xab), F(0x76), \
+	F(0xca), F(0x82), F(0xc9), F(0x7d), F(0xfa), F(0x59), F(0x47), F(0xf0), F(0xad), F(0xd4), F(0xa2), F(0xaf), F(0x9c), F(0xa4), F(0x72), F(0xc0), \
+	F(0xb7), F(0xfd), F(0x93), F(0x26), F(0x36), F(0x3f), F(0xf7), F(0xcc), F(0x34), F(0xa5), F(0xe5), F(0xf1), F(0x71), F(0xd8), F(0x31), F(0x15), \
+	F(0x04), F(0xc7), F(0x23), F(0xc3), F(0x18), F(0x96), F(0x05), F(0x9a), F(0x07), F(0x12), F(0x80), F(0xe2), F(0xeb), F(0x27), F(0xb2), F(0x75), \
+	F(0x09), F(0x83), F(0x2c), F(0x1a), F(0x1b), F(0x6e), F(0x5a), F(0xa0), F(0x52), F(0x3b), F(0xd6), F(0xb3), F(0x29), F(0xe3), F(0x2f), F(0x84), \
+	F(0x53), F(0xd1), F(0x00), F(0xed), F(0x20), F(0xfc), F(0xb1), F(0x5b), F(0x6a), F(0xcb), F(0xbe), F(0x39), F(0x4a), F(0x4c), F(0x58), F(0xcf), \
+	F(0xd0), F(0xef), F(0xaa), F(0xfb), F(0x43), F(0x4d), F(0x33), F(0x85), F(0x45), F(0xf9), F(0x02), F(0x7f), F(0x50), F(0x3c), F(0x9f), F(0xa8), \
+	F(0x51), F(0xa3), F(0x40), F(0x8f), F(0x92), F(0x9d), F(0x38), F(0xf5), F(0xbc), F(0xb6), F(0xda), F(0x21), F(0x10), F(0xff), F(0xf3), F(0xd2), \
+	F(0xcd), F(0x0c), F(0x13), F(0xec), F(0x5f), F(0x97), F(0x44), F(0x17), F(0xc4), F(0xa7), F(0x7e), F(0x3d), F(0x64), F(0x5d), F(0x19), F(0x73), \
+	F(0x60), F(0x81), F(0x4f), F(0xdc), F(0x22), F(0x2a), F(0x90), F(0x88), F(0x46), F(0xee), F(0xb8), F(0x14), F(0xde), F(0x5e), F(0x0b), F(0xdb), \
+	F(0xe0), F(0x32), F(0x3a), F(0x0a), F(0x49), F(0x06), F(0x24), F(0x5c), F(0xc2), F(0xd3), F(0xac), F(0x62), F(0x91), F(0x95), F(0xe4), F(0x79), \
+	F(0xe7), F(0xc8), F(0x37), F(0x6d), F(0x8d), F(0xd5), F(0x4e), F(0xa9), F(0x6c), F(0x56), F(0xf4), F(0xea), F(0x65), F(0x7a), F(0xae), F(0x08), \
+	F(0xba), F(0x78), F(0x25), F(0x2e), F(0x1c), F(0xa6), F(0xb4), F(0xc6), F(0xe8), F(0xdd), F(0x74), F(0x1f), F(0x4b), F(0xbd), F(0x8b), F(0x8a), \
+	F(0x70), F(0x3e), F(0xb5), F(0x66), F(0x48), F(0x03), F(0xf6), F(0x0e), F(0x61), F(0x35), F(0x57), F(0xb9), F(0x86), F(0xc1), F(0x1d), F(0x9e), \
+	F(0xe1), F(0xf8), F(0x98), F(0x11), F(0x69), F(0xd9), F(0x8e), F(0x94), F(0x9b), F(0x1e), F(0x87), F(0xe9), F(0xce), F(0x55), F(0x28), F(0xdf), \
+	F(0x8c), F(0xa1), F(0x89), F(0x0d), F(0xbf), F(0xe6), F(0x42), F(0x68), F(0x41), F(0x99), F(0x2d), F(0x0f), F(0xb0), F(0x54), F(0xbb), F(0x16)
+
+// Column contribution of S-box output s in row r: (2s, s, s, 3s) rotated down r rows
+#define XT(s)		((((s) << 1) ^ (((s) >> 7) * 0x1b)) & 0xff)
+#define TE0(s)		((uint32_t)XT(s) | ((uint32_t)(s) << 8) | ((uint32_t)(s) << 16) | ((uint32_t)(XT(s) ^ (s)) << 24))
+#define TE1(s)		((uint32_t)(XT(s) ^ (s)) | ((uint32_t)XT(s) << 8) | ((uint32_t)(s) << 16) | ((uint32_t)(s) << 24))
+#define TE2(s)		((uint32_t)(s) | ((uint32_t)(XT(s) ^ (s)) << 8) | ((uint32_t)XT(s) << 16) | ((uint32_t)(s) << 24))
+#define TE3(s)		((uint32_t)(s) | ((uint32_t)(s) << 8) | ((uint32_t)(XT(s) ^ (s)) << 16) | ((uint32_t)XT(s) << 24))
+#define SB(s)		(s)
+
+static const uint32_t	te0[256] = {SBOX(TE0)};
+static const uint32_t	te1[256] = {SBOX(TE1)};
+static const uint32_t	te2[256] = {SBOX(TE2)};
+static const uint32_t	te3[256] = {SBOX(TE3)};
+static const uint8_t	sbox[256] = {SBOX(SB)};
+
+#undef SB
+#undef TE3
+#undef TE2
+#undef TE1
+#undef TE0
+#undef XT
+#undef SBOX
+
+// Areion round constants, as columns of the x86 backend's RC0
+static const uint32_t RC[15*4] = {
+	0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344,
+	0xa4093822, 0x299f31d0, 0x082efa98, 0xec4e6c89,
+	0x452821e6, 0x38d01377, 0xbe5466cf, 0x34e90c6c,
+	0xc0ac29b7, 0xc97c50dd, 0x3f84d5b5, 0xb5470917,
+	0x9216d5d9, 0x8979fb1b, 0xd1310ba6, 0x98dfb5ac,
+	0x2ffd72db, 0xd01adfb7, 0xb8e1afed, 0x6a267e96,
+	0xba7c9045, 0xf12c7f99, 0x24a19947, 0xb3916cf7,
+	0x801f2e28, 0x58efc166, 0x36920d87, 0x1574e690,
+	0xa458fea3, 0xf4933d7e, 0x0d95748f, 0x728eb658,
+	0x718bcd58, 0x82154aee, 0x7b54a41d, 0xc25a59b5,
+	0x9c30d539, 0x2af26013, 0xc5d1b023, 0x286085f0,
+	0xca417918, 0xb8db38ef, 0x8e79dcb0, 0x603a180e,
+	0x6c9e0e8b, 0xb01e8a3e, 0xd71577c1, 0xbd314b27,
+	0x78af2fda, 0x55605c60, 0xe65525f3, 0xaa55ab94,
+	0x57489862, 0x63e81440, 0x55ca396a, 0x2aab10b6,
+};
+#define RC0(i, c)	RC[(i)*4 + 3 - (c)]
+
+typedef uint32_t	block[4];		// AES state, one little endian column per word
+
+// AES round primitives <<<
+// out = MixColumns(ShiftRows(SubBytes(in))) ^ key, as aesenc
+static inline void aesenc(block out, const block in, const block key) //<<<
+{
+	const uint32_t	a0 = in[0], a1 = in[1], a2 = in[2], a3 = in[3];
+
+	out[0] = te0[a0 & 0xff] ^ te1[(a1 >> 8) & 0xff] ^ te2[(a2 >> 16) & 0xff] ^ te3[a3 >> 24] ^ key[0];
+	out[1] = te0[a1 & 0xff] ^ te1[(a2 >> 8) & 0xff] ^ te2[(a3 >> 16) & 0xff] ^ te3[a0 >> 24] ^ key[1];
+	out[2] = te0[a2 & 0xff] ^ te1[(a3 >> 8) & 0xff] ^ te2[(a0 >> 16) & 0xff] ^ te3[a1 >> 24] ^ key[2];
+	out[3] = te0[a3 & 0xff] ^ te1[(a0 >> 8) & 0xff] ^ te2[(a1 >> 16) & 0xff] ^ te3[a2 >> 24] ^ key[3];
+}
+
+//>>>
+// x = ShiftRows(SubBytes(x)), as aesenclast with a zero key
+static inline void aesenclast0(block x) //<<<
+{
+	const uint32_t	a0 = x[0], a1 = x[1], a2 = x[2], a3 = x[3];
+
+#define COL(w0, w1, w2, w3) \
+	((uint32_t)sbox[(w0) & 0xff] | ((uint32_t)sbox[((w1) >> 8) & 0xff] << 8) | \
+	 ((uint32_t)sbox[((w2) >> 16) & 0xff] << 16) | ((uint32_t)sbox[(w3) >> 24] << 24))
+	x[0] = COL(a0, a1, a2, a3);
+	x[1] = COL(a1, a2, a3, a0);
+	x[2] = COL(a2, a3, a0, a1);
+	x[3] = COL(a3, a0, a1, a2);
+#undef COL
+}
+
+//>>>
+static inline void rc0(block rc, int i) //<<<
+{
+	for (int c=0; c<4; c++)
+		rc[c] = RC0(i, c);
+}
+
+//>>>
+static inline uint32_t le32(const uint8_t* p) //<<<
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+//>>>
+static inline void put_le32(uint8_t* p, uint32_t w) //<<<
+{
+	p[0] = (uint8_t) w;
+	p[1] = (uint8_t)(w >> 8);
+	p[2] = (uint8_t)(w >> 16);
+	p[3] = (uint8_t)(w >> 24);
+}
+
+//>>>
+static inline void load(uint32_t* w, const uint8_t* p, int nwords) //<<<
+{
+	for (int i=0; i<nwords; i++)
+		w[i] = le32(p + 4*i);
+}
+
+//>>>
+static inline void store(uint8_t* p, const uint32_t* w, int nwords) //<<<
+{
+	for (int i=0; i<nwords; i++)
+		put_le32(p + 4*i, w[i]);
+}
+
+//>>>
+//>>>
+// Permutations <<<
+/*
+ * x1 = aesenc(aesenc(x0, RC0), x1)
+ * x0 = aesenclast(x0, RC1)
+ */
+static inline void round_256(block x0, block x1, int i) //<<<
+{
+	block	rc, t;
+
+	rc0(rc, i);
+	aesenc(t, x0, rc);
+	aesenc(x1, t, x1);
+	aesenclast0(x0);
+}
+
+//>>>
+static void perm256(block x[2]) //<<<
+{
+	for (int i=0; i<10; i+=2) {
+		round_256(x[0], x[1], i);
+		round_256(x[1], x[0], i+1);
+	}
+}
+
+//>>>
+/*
+ * x1 = aesenc(x0, x1)
+ * x3 = aesenc(x2, x3)
+ * x0 = aesenclast(x0, RC1)
+ * x2 = aesenc(aesenclast(x2, RC0), RC1)
+ */
+static inline void round_512(block x0, block x1, block x2, block x3, int i) //<<<
+{
+	static const block	zero = {0};
+	block				t;
+
+	aesenc(x1, x0, x1);
+	aesenc(x3, x2, x3);
+	aesenclast0(x0);
+	aesenclast0(x2);
+	for (int c=0; c<4; c++)
+		t[c] = x2[c] ^ RC0(i, c);
+	aesenc(x2, t, zero);
+}
+
+//>>>
+// Leaves the result in x3, x0, x1, x2 order like perm512
+static void perm512(block x[4]) //<<<
+{
+	for (int i=0; i<12; i+=4) {
+		round_512(x[0], x[1], x[2], x[3], i);
+		round_512(x[1], x[2], x[3], x[0], i+1);
+		round_512(x[2], x[3], x[0], x[1], i+2);
+		round_512(x[3], x[0], x[1], x[2], i+3);
+	}
+	round_512(x[0], x[1], x[2], x[3], 12);
+	round_512(x[1], x[2], x[3], x[0], 13);
+	round_512(x[2], x[3], x[0], x[1], 14);
+}
+
+//>>>
+/*
+ * Davies-Meyer of perm512 on the 16 columns in w, truncated to 64 bit words
+ * 1, 3, 4 and 6 (columns 2-3, 6-7, 8-9 and 12-13 of the x3, x0, x1, x2
+ * output) as aerion_trunc
+ */
+static void dm512(uint32_t h[8], const uint32_t w[16]) //<<<
+{
+	block	x[4];
+
+	memcpy(x, w, sizeof(x));
+	perm512(x);
+
+	h[0] = x[3][2] ^ w[2];
+	h[1] = x[3][3] ^ w[3];
+	h[2] = x[0][2] ^ w[6];
+	h[3] = x[0][3] ^ w[7];
+	h[4] = x[1][0] ^ w[8];
+	h[5] = x[1][1] ^ w[9];
+	h[6] = x[2][0] ^ w[12];
+	h[7] = x[2][1] ^ w[13];
+}
+
+//>>>
+//>>>
+// Backend functions <<<
+static void tt_perm256(uint8_t out[32], const uint8_t in[32]) //<<<
+{
+	block	x[2];
+
+	load(x[0], in, 8);
+	perm256(x);
+	store(out, x[0], 8);
+}
+
+//>>>
+static void tt_perm512(uint8_t out[64], const uint8_t in[64]) //<<<
+{
+	block	x[4];
+
+	load(x[0], in, 16);
+	perm512(x);
+	store(out,      x[3], 4);
+	store(out + 16, x[0], 12);
+}
+
+//>>>
+static void tt_dm256(uint8_t out[32], const uint8_t in[32]) //<<<
+{
+	block	x[2];
+	uint8_t	tmp[32];
+
+	load(x[0], in, 8);
+	perm256(x);
+	store(tmp, x[0], 8);
+	for (int i=0; i<32; i++)
+		out[i] = tmp[i] ^ in[i];
+}
+
+//>>>
+static void tt_dm512(uint8_t out[32], const uint8_t in[64]) //<<<
+{
+	uint32_t	w[16], h[8];
+
+	load(w, in, 16);
+	dm512(h, w);
+	store(out, h, 8);
+}
+
+//>>>
+static void tt_md_compress(uint8_t state[32], const uint8_t* blocks, size_t nblocks) //<<<
+{
+	uint32_t	w[16], h[8];
+
+	// The chaining value stays in w[8..15] from one block to the next
+	load(w + 8, state, 8);
+	for (; nblocks; nblocks--, blocks += 32) {
+		load(w, blocks, 8);
+		dm512(h, w);
+		memcpy(w + 8, h, sizeof(h));
+	}
+	store(state, w + 8, 8);
+}
+
+//>>>
+//>>>
+
+const struct areion_impl areion_impl_ttable = {
+	.name			= "ttable",
+	.requires		= 0,
+	.perm256		= tt_perm256,
+	.perm512		= tt_perm512,
+	.dm256			= tt_dm256,
+	.dm512			= tt_dm512,
+	.md_compress	= tt_md_compress,
+};
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
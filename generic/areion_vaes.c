@@ -0,0 +1,181 @@
+/*
+ * VAES Areion backend for the batch forms: the permutations from
+ * areion_x86.h widened to 256 bit registers, with two independent states per
+ * register (one in each 128 bit half) and two register sets in flight, so 4
+ * blocks go through the AES units together instead of each aesenc waiting
+ * on the previous one.  Compiled with -mavx2 -maes -mvaes, only called when
+ * the host CPU (and OS) report support for all three.
+ *
+ * There are no single block functions here, those stay on the AES-NI
+ * backend.
+ */
+
+#include "areion.h"
+#include "cpu.h"
+
+#if defined(__VAES__) && defined(__AVX2__) && defined(__AES__)
+#include "areion_x86.h"
+
+#define RC0Y(i)		_mm256_broadcastsi128_si256(RC0(i))
+#define RC1Y(i)		_mm256_setzero_si256()
+
+/* Round Function for the 256-bit permutation, register sets a and b */
+#define Round_Function_256_x4(a0, a1, b0, b1, i) do { \
+	const __m256i	rc0 = RC0Y(i); \
+	a1 = _mm256_aesenc_epi128(_mm256_aesenc_epi128(a0, rc0), a1); \
+	b1 = _mm256_aesenc_epi128(_mm256_aesenc_epi128(b0, rc0), b1); \
+	a0 = _mm256_aesenclast_epi128(a0, RC1Y(i)); \
+	b0 = _mm256_aesenclast_epi128(b0, RC1Y(i)); \
+} while (0)
+
+/* 256-bit permutation of 4 states */
+#define perm256_x4(a0, a1, b0, b1) do { \
+	Round_Function_256_x4(a0, a1, b0, b1, 0); \
+	Round_Function_256_x4(a1, a0, b1, b0, 1); \
+	Round_Function_256_x4(a0, a1, b0, b1, 2); \
+	Round_Function_256_x4(a1, a0, b1, b0, 3); \
+	Round_Function_256_x4(a0, a1, b0, b1, 4); \
+	Round_Function_256_x4(a1, a0, b1, b0, 5); \
+	Round_Function_256_x4(a0, a1, b0, b1, 6); \
+	Round_Function_256_x4(a1, a0, b1, b0, 7); \
+	Round_Function_256_x4(a0, a1, b0, b1, 8); \
+	Round_Function_256_x4(a1, a0, b1, b0, 9); \
+} while (0)
+
+/* Round Function for the 512-bit permutation, register sets a and b */
+#define Round_Function_512_x4(a0, a1, a2, a3, b0, b1, b2, b3, i) do { \
+	const __m256i	rc0 = RC0Y(i); \
+	a1 = _mm256_aesenc_epi128(a0, a1); \
+	b1 = _mm256_aesenc_epi128(b0, b1); \
+	a3 = _mm256_aesenc_epi128(a2, a3); \
+	b3 = _mm256_aesenc_epi128(b2, b3); \
+	a0 = _mm256_aesenclast_epi128(a0, RC1Y(i)); \
+	b0 = _mm256_aesenclast_epi128(b0, RC1Y(i)); \
+	a2 = _mm256_aesenc_epi128(_mm256_aesenclast_epi128(a2, rc0), RC1Y(i)); \
+	b2 = _mm256_aesenc_epi128(_mm256_aesenclast_epi128(b2, rc0), RC1Y(i)); \
+} while (0)
+
+/* 512-bit permutation of 4 states, leaves the result in x3, x0, x1, x2 order like perm512 */
+#define perm512_x4(a0, a1, a2, a3, b0, b1, b2, b3) do { \
+	Round_Function_512_x4(a0, a1, a2, a3, b0, b1, b2, b3, 0); \
+	Round_Function_512_x4(a1, a2, a3, a0, b1, b2, b3, b0, 1); \
+	Round_Function_512_x4(a2, a3, a0, a1, b2, b3, b0, b1, 2); \
+	Round_Function_512_x4(a3, a0, a1, a2, b3, b0, b1, b2, 3); \
+	Round_Function_512_x4(a0, a1, a2, a3, b0, b1, b2, b3, 4); \
+	Round_Function_512_x4(a1, a2, a3, a0, b1, b2, b3, b0, 5); \
+	Round_Function_512_x4(a2, a3, a0, a1, b2, b3, b0, b1, 6); \
+	Round_Function_512_x4(a3, a0, a1, a2, b3, b0, b1, b2, 7); \
+	Round_Function_512_x4(a0, a1, a2, a3, b0, b1, b2, b3, 8); \
+	Round_Function_512_x4(a1, a2, a3, a0, b1, b2, b3, b0, 9); \
+	Round_Function_512_x4(a2, a3, a0, a1, b2, b3, b0, b1, 10); \
+	Round_Function_512_x4(a3, a0, a1, a2, b3, b0, b1, b2, 11); \
+	Round_Function_512_x4(a0, a1, a2, a3, b0, b1, b2, b3, 12); \
+	Round_Function_512_x4(a1, a2, a3, a0, b1, b2, b3, b0, 13); \
+	Round_Function_512_x4(a2, a3, a0, a1, b2, b3, b0, b1, 14); \
+} while (0)
+
+static inline __m256i load_x2(const uint8_t* lo, const uint8_t* hi) //<<<
+{
+	return _mm256_inserti128_si256(
+		_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)lo)),
+		_mm_loadu_si128((const __m128i*)hi), 1);
+}
+
+//>>>
+static inline void store_x2(uint8_t* lo, uint8_t* hi, __m256i v) //<<<
+{
+	_mm_storeu_si128((__m128i*)lo, _mm256_castsi256_si128(v));
+	_mm_storeu_si128((__m128i*)hi, _mm256_extracti128_si256(v, 1));
+}
+
+//>>>
+static void vaes_dm256_x4(uint8_t out[4][32], const uint8_t* const in[4]) //<<<
+{
+	__m256i	a0 = load_x2(in[0],      in[1]);
+	__m256i	a1 = load_x2(in[0] + 16, in[1] + 16);
+	__m256i	b0 = load_x2(in[2],      in[3]);
+	__m256i	b1 = load_x2(in[2] + 16, in[3] + 16);
+	const __m256i	orig_a0 = a0, orig_a1 = a1, orig_b0 = b0, orig_b1 = b1;
+
+	perm256_x4(a0, a1, b0, b1);
+
+	store_x2(out[0],      out[1],      _mm256_xor_si256(a0, orig_a0));
+	store_x2(out[0] + 16, out[1] + 16, _mm256_xor_si256(a1, orig_a1));
+	store_x2(out[2],      out[3],      _mm256_xor_si256(b0, orig_b0));
+	store_x2(out[2] + 16, out[3] + 16, _mm256_xor_si256(b1, orig_b1));
+}
+
+//>>>
+static void vaes_dm512_x4(uint8_t out[4][32], const uint8_t* const in[4]) //<<<
+{
+	__m256i	a0 = load_x2(in[0],      in[1]);
+	__m256i	a1 = load_x2(in[0] + 16, in[1] + 16);
+	__m256i	a2 = load_x2(in[0] + 32, in[1] + 32);
+	__m256i	a3 = load_x2(in[0] + 48, in[1] + 48);
+	__m256i	b0 = load_x2(in[2],      in[3]);
+	__m256i	b1 = load_x2(in[2] + 16, in[3] + 16);
+	__m256i	b2 = load_x2(in[2] + 32, in[3] + 32);
+	__m256i	b3 = load_x2(in[2] + 48, in[3] + 48);
+	const __m256i	orig_a0 = a0, orig_a1 = a1, orig_a2 = a2, orig_a3 = a3;
+	const __m256i	orig_b0 = b0, orig_b1 = b1, orig_b2 = b2, orig_b3 = b3;
+	uint8_t			tmp[4][64] __attribute__((aligned(16)));
+
+	perm512_x4(a0, a1, a2, a3, b0, b1, b2, b3);
+
+	store_x2(tmp[0],      tmp[1],      _mm256_xor_si256(a3, orig_a0));
+	store_x2(tmp[0] + 16, tmp[1] + 16, _mm256_xor_si256(a0, orig_a1));
+	store_x2(tmp[0] + 32, tmp[1] + 32, _mm256_xor_si256(a1, orig_a2));
+	store_x2(tmp[0] + 48, tmp[1] + 48, _mm256_xor_si256(a2, orig_a3));
+	store_x2(tmp[2],      tmp[3],      _mm256_xor_si256(b3, orig_b0));
+	store_x2(tmp[2] + 16, tmp[3] + 16, _mm256_xor_si256(b0, orig_b1));
+	store_x2(tmp[2] + 32, tmp[3] + 32, _mm256_xor_si256(b1, orig_b2));
+	store_x2(tmp[2] + 48, tmp[3] + 48, _mm256_xor_si256(b2, orig_b3));
+
+	for (int lane=0; lane<4; lane++)
+		aerion_trunc((const uint64_t*)tmp[lane], (uint64_t*)out[lane]);
+}
+
+//>>>
+static void vaes_md_compress_x4(uint8_t state[4][32], const uint8_t* const data[4], size_t nblocks) //<<<
+{
+	// The chaining values stay in registers from one block to the next
+	__m256i	ha_lo = load_x2(state[0],      state[1]);
+	__m256i	ha_hi = load_x2(state[0] + 16, state[1] + 16);
+	__m256i	hb_lo = load_x2(state[2],      state[3]);
+	__m256i	hb_hi = load_x2(state[2] + 16, state[3] + 16);
+
+	for (size_t ofs=0; ofs < nblocks*32; ofs += 32) {
+		const __m256i	orig_a0 = load_x2(data[0] + ofs,      data[1] + ofs);
+		const __m256i	orig_a1 = load_x2(data[0] + ofs + 16, data[1] + ofs + 16);
+		const __m256i	orig_b0 = load_x2(data[2] + ofs,      data[3] + ofs);
+		const __m256i	orig_b1 = load_x2(data[2] + ofs + 16, data[3] + ofs + 16);
+		__m256i	a0 = orig_a0, a1 = orig_a1, a2 = ha_lo, a3 = ha_hi;
+		__m256i	b0 = orig_b0, b1 = orig_b1, b2 = hb_lo, b3 = hb_hi;
+
+		perm512_x4(a0, a1, a2, a3, b0, b1, b2, b3);
+
+		// Davies-Meyer feed forward, truncated to 64 bit words 1, 3, 4 and 6
+		ha_hi = _mm256_unpacklo_epi64(_mm256_xor_si256(a1, ha_lo), _mm256_xor_si256(a2, ha_hi));
+		hb_hi = _mm256_unpacklo_epi64(_mm256_xor_si256(b1, hb_lo), _mm256_xor_si256(b2, hb_hi));
+		ha_lo = _mm256_unpackhi_epi64(_mm256_xor_si256(a3, orig_a0), _mm256_xor_si256(a0, orig_a1));
+		hb_lo = _mm256_unpackhi_epi64(_mm256_xor_si256(b3, orig_b0), _mm256_xor_si256(b0, orig_b1));
+	}
+
+	store_x2(state[0],      state[1],      ha_lo);
+	store_x2(state[0] + 16, state[1] + 16, ha_hi);
+	store_x2(state[2],      state[3],      hb_lo);
+	store_x2(state[2] + 16, state[3] + 16, hb_hi);
+}
+
+//>>>
+
+const struct areion_impl areion_impl_vaes = {
+	.name			= "vaes",
+	.requires		= CPU_AES | CPU_AVX2 | CPU_VAES,
+	.dm256_x4		= vaes_dm256_x4,
+	.dm512_x4		= vaes_dm512_x4,
+	.md_compress_x4	= vaes_md_compress_x4,
+};
+#endif
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
@@ -0,0 +1,236 @@
+/*
+ * AES-NI Areion backend.  Compiled with -msse4.1 -maes, only called when
+ * the host CPU reports support for both.
+ */
+
+#include "areion.h"
+#include "cpu.h"
+
+#if defined(__AES__) && defined(__SSE4_1__)
+#include "areion_x86.h"
+
+#define LOAD(p)		_mm_loadu_si128((const __m128i*)(p))
+#define STORE(p, v)	_mm_storeu_si128((__m128i*)(p), (v))
+
+/*
+ * The Davies-Meyer feed forward of perm512's x3, x0, x1, x2 output l on the
+ * input o, truncated to 64 bit words 1, 3, 4 and 6 with shuffles rather than
+ * a round trip through memory
+ */
+#define DM512_TRUNC(l, o, lo, hi) do { \
+	lo = _mm_unpackhi_epi64(_mm_xor_si128(l[3], o[0]), _mm_xor_si128(l[0], o[1])); \
+	hi = _mm_unpacklo_epi64(_mm_xor_si128(l[1], o[2]), _mm_xor_si128(l[2], o[3])); \
+} while (0)
+
+static void x86_perm256(uint8_t out[32], const uint8_t in[32]) //<<<
+{
+	__m128i	x0 = _mm_loadu_si128((__m128i*)(in));
+	__m128i	x1 = _mm_loadu_si128((__m128i*)(in + 16));
+	perm256(x0, x1);
+	_mm_storeu_si128((__m128i*) out,       x0);
+	_mm_storeu_si128((__m128i*)(out + 16), x1);
+}
+
+//>>>
+static void x86_perm512(uint8_t out[64], const uint8_t in[64]) //<<<
+{
+	__m128i	x0 = _mm_loadu_si128((__m128i*)(in));
+	__m128i	x1 = _mm_loadu_si128((__m128i*)(in + 16));
+	__m128i	x2 = _mm_loadu_si128((__m128i*)(in + 32));
+	__m128i	x3 = _mm_loadu_si128((__m128i*)(in + 48));
+
+	__m128i	res[4];
+	permute_areion_512(res, (__m128i[]){x0, x1, x2, x3});
+
+	_mm_storeu_si128((__m128i*) out,       res[0]);
+	_mm_storeu_si128((__m128i*)(out + 16), res[1]);
+	_mm_storeu_si128((__m128i*)(out + 32), res[2]);
+	_mm_storeu_si128((__m128i*)(out + 48), res[3]);
+}
+
+//>>>
+static void x86_dm256(uint8_t out[32], const uint8_t in[32]) //<<<
+{
+	__m128i	x0 = _mm_loadu_si128((__m128i*)(in));
+	__m128i	x1 = _mm_loadu_si128((__m128i*)(in + 16));
+	__m128i orig_x0 = x0;
+	__m128i orig_x1 = x1;
+	perm256(x0, x1);
+	x0 = _mm_xor_si128(x0, orig_x0);
+	x1 = _mm_xor_si128(x1, orig_x1);
+	_mm_storeu_si128((__m128i*) out,       x0);
+	_mm_storeu_si128((__m128i*)(out + 16), x1);
+}
+
+//>>>
+static void x86_dm512(uint8_t out[32], const uint8_t in[64]) //<<<
+{
+	const __m128i	o[4] = {LOAD(in), LOAD(in + 16), LOAD(in + 32), LOAD(in + 48)};
+	__m128i			x[4] = {o[0], o[1], o[2], o[3]};
+	__m128i			lo, hi;
+
+	perm512(x[0], x[1], x[2], x[3]);
+
+	DM512_TRUNC(x, o, lo, hi);
+	STORE(out,      lo);
+	STORE(out + 16, hi);
+}
+
+//>>>
+static void x86_md_compress(uint8_t state[32], const uint8_t* blocks, size_t nblocks) //<<<
+{
+	// The chaining value stays in registers from one block to the next
+	__m128i	h[2] = {LOAD(state), LOAD(state + 16)};
+
+	for (; nblocks; nblocks--, blocks += 32) {
+		const __m128i	o[4] = {LOAD(blocks), LOAD(blocks + 16), h[0], h[1]};
+		__m128i			x[4] = {o[0], o[1], o[2], o[3]};
+
+		perm512(x[0], x[1], x[2], x[3]);
+
+		DM512_TRUNC(x, o, h[0], h[1]);
+	}
+
+	STORE(state,      h[0]);
+	STORE(state + 16, h[1]);
+}
+
+//>>>
+// Multi-lane: 4 independent states with their rounds interleaved, so each aesenc's latency is hidden behind the others <<<
+#define Round_Function_256_x4(a, b, i) do { \
+	Round_Function_256(l0[a], l0[b], i); \
+	Round_Function_256(l1[a], l1[b], i); \
+	Round_Function_256(l2[a], l2[b], i); \
+	Round_Function_256(l3[a], l3[b], i); \
+} while (0)
+
+#define perm256_x4() do { \
+	Round_Function_256_x4(0, 1, 0); \
+	Round_Function_256_x4(1, 0, 1); \
+	Round_Function_256_x4(0, 1, 2); \
+	Round_Function_256_x4(1, 0, 3); \
+	Round_Function_256_x4(0, 1, 4); \
+	Round_Function_256_x4(1, 0, 5); \
+	Round_Function_256_x4(0, 1, 6); \
+	Round_Function_256_x4(1, 0, 7); \
+	Round_Function_256_x4(0, 1, 8); \
+	Round_Function_256_x4(1, 0, 9); \
+} while (0)
+
+#define Round_Function_512_x4(a, b, c, d, i) do { \
+	Round_Function_512(l0[a], l0[b], l0[c], l0[d], i); \
+	Round_Function_512(l1[a], l1[b], l1[c], l1[d], i); \
+	Round_Function_512(l2[a], l2[b], l2[c], l2[d], i); \
+	Round_Function_512(l3[a], l3[b], l3[c], l3[d], i); \
+} while (0)
+
+/* Leaves the result in x3, x0, x1, x2 order like perm512 */
+#define perm512_x4() do { \
+	Round_Function_512_x4(0, 1, 2, 3, 0); \
+	Round_Function_512_x4(1, 2, 3, 0, 1); \
+	Round_Function_512_x4(2, 3, 0, 1, 2); \
+	Round_Function_512_x4(3, 0, 1, 2, 3); \
+	Round_Function_512_x4(0, 1, 2, 3, 4); \
+	Round_Function_512_x4(1, 2, 3, 0, 5); \
+	Round_Function_512_x4(2, 3, 0, 1, 6); \
+	Round_Function_512_x4(3, 0, 1, 2, 7); \
+	Round_Function_512_x4(0, 1, 2, 3, 8); \
+	Round_Function_512_x4(1, 2, 3, 0, 9); \
+	Round_Function_512_x4(2, 3, 0, 1, 10); \
+	Round_Function_512_x4(3, 0, 1, 2, 11); \
+	Round_Function_512_x4(0, 1, 2, 3, 12); \
+	Round_Function_512_x4(1, 2, 3, 0, 13); \
+	Round_Function_512_x4(2, 3, 0, 1, 14); \
+} while (0)
+
+static void x86_dm256_x4(uint8_t out[4][32], const uint8_t* const in[4]) //<<<
+{
+	__m128i	l0[2] = {LOAD(in[0]), LOAD(in[0] + 16)};
+	__m128i	l1[2] = {LOAD(in[1]), LOAD(in[1] + 16)};
+	__m128i	l2[2] = {LOAD(in[2]), LOAD(in[2] + 16)};
+	__m128i	l3[2] = {LOAD(in[3]), LOAD(in[3] + 16)};
+
+	perm256_x4();
+
+	STORE(out[0],      _mm_xor_si128(l0[0], LOAD(in[0])));
+	STORE(out[0] + 16, _mm_xor_si128(l0[1], LOAD(in[0] + 16)));
+	STORE(out[1],      _mm_xor_si128(l1[0], LOAD(in[1])));
+	STORE(out[1] + 16, _mm_xor_si128(l1[1], LOAD(in[1] + 16)));
+	STORE(out[2],      _mm_xor_si128(l2[0], LOAD(in[2])));
+	STORE(out[2] + 16, _mm_xor_si128(l2[1], LOAD(in[2] + 16)));
+	STORE(out[3],      _mm_xor_si128(l3[0], LOAD(in[3])));
+	STORE(out[3] + 16, _mm_xor_si128(l3[1], LOAD(in[3] + 16)));
+}
+
+//>>>
+static void x86_dm512_x4(uint8_t out[4][32], const uint8_t* const in[4]) //<<<
+{
+	const __m128i	o0[4] = {LOAD(in[0]), LOAD(in[0] + 16), LOAD(in[0] + 32), LOAD(in[0] + 48)};
+	const __m128i	o1[4] = {LOAD(in[1]), LOAD(in[1] + 16), LOAD(in[1] + 32), LOAD(in[1] + 48)};
+	const __m128i	o2[4] = {LOAD(in[2]), LOAD(in[2] + 16), LOAD(in[2] + 32), LOAD(in[2] + 48)};
+	const __m128i	o3[4] = {LOAD(in[3]), LOAD(in[3] + 16), LOAD(in[3] + 32), LOAD(in[3] + 48)};
+	__m128i			l0[4] = {o0[0], o0[1], o0[2], o0[3]};
+	__m128i			l1[4] = {o1[0], o1[1], o1[2], o1[3]};
+	__m128i			l2[4] = {o2[0], o2[1], o2[2], o2[3]};
+	__m128i			l3[4] = {o3[0], o3[1], o3[2], o3[3]};
+	__m128i			lo, hi;
+
+	perm512_x4();
+
+	DM512_TRUNC(l0, o0, lo, hi);	STORE(out[0], lo);	STORE(out[0] + 16, hi);
+	DM512_TRUNC(l1, o1, lo, hi);	STORE(out[1], lo);	STORE(out[1] + 16, hi);
+	DM512_TRUNC(l2, o2, lo, hi);	STORE(out[2], lo);	STORE(out[2] + 16, hi);
+	DM512_TRUNC(l3, o3, lo, hi);	STORE(out[3], lo);	STORE(out[3] + 16, hi);
+}
+
+//>>>
+static void x86_md_compress_x4(uint8_t state[4][32], const uint8_t* const data[4], size_t nblocks) //<<<
+{
+	// The chaining values stay in registers from one block to the next
+	__m128i	h0[2] = {LOAD(state[0]), LOAD(state[0] + 16)};
+	__m128i	h1[2] = {LOAD(state[1]), LOAD(state[1] + 16)};
+	__m128i	h2[2] = {LOAD(state[2]), LOAD(state[2] + 16)};
+	__m128i	h3[2] = {LOAD(state[3]), LOAD(state[3] + 16)};
+
+	for (size_t ofs=0; ofs < nblocks*32; ofs += 32) {
+		const __m128i	o0[4] = {LOAD(data[0] + ofs), LOAD(data[0] + ofs + 16), h0[0], h0[1]};
+		const __m128i	o1[4] = {LOAD(data[1] + ofs), LOAD(data[1] + ofs + 16), h1[0], h1[1]};
+		const __m128i	o2[4] = {LOAD(data[2] + ofs), LOAD(data[2] + ofs + 16), h2[0], h2[1]};
+		const __m128i	o3[4] = {LOAD(data[3] + ofs), LOAD(data[3] + ofs + 16), h3[0], h3[1]};
+		__m128i			l0[4] = {o0[0], o0[1], o0[2], o0[3]};
+		__m128i			l1[4] = {o1[0], o1[1], o1[2], o1[3]};
+		__m128i			l2[4] = {o2[0], o2[1], o2[2], o2[3]};
+		__m128i			l3[4] = {o3[0], o3[1], o3[2], o3[3]};
+
+		perm512_x4();
+
+		DM512_TRUNC(l0, o0, h0[0], h0[1]);
+		DM512_TRUNC(l1, o1, h1[0], h1[1]);
+		DM512_TRUNC(l2, o2, h2[0], h2[1]);
+		DM512_TRUNC(l3, o3, h3[0], h3[1]);
+	}
+
+	STORE(state[0], h0[0]);	STORE(state[0] + 16, h0[1]);
+	STORE(state[1], h1[0]);	STORE(state[1] + 16, h1[1]);
+	STORE(state[2], h2[0]);	STORE(state[2] + 16, h2[1]);
+	STORE(state[3], h3[0]);	STORE(state[3] + 16, h3[1]);
+}
+
+//>>>
+//>>>
+
+const struct areion_impl areion_impl_x86 = {
+	.name			= "aesni",
+	.requires		= CPU_SSE41 | CPU_AES,
+	.perm256		= x86_perm256,
+	.perm512		= x86_perm512,
+	.dm256			= x86_dm256,
+	.dm512			= x86_dm512,
+	.md_compress	= x86_md_compress,
+	.dm256_x4		= x86_dm256_x4,
+	.dm512_x4		= x86_dm512_x4,
+	.md_compress_x4	= x86_md_compress_x4,
+};
+#endif
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
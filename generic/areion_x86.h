@@ -45,7 +45,7 @@ static void debug_print_m128i(const char* name, __m128i val) //<<<
 #endif
 
 /* Round Constants */
-const uint32_t RC[15*4] = {
+static const uint32_t RC[15*4] = {
 	0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344,
 	0xa4093822, 0x299f31d0, 0x082efa98, 0xec4e6c89,
 	0x452821e6, 0x38d01377, 0xbe5466cf, 0x34e90c6c,
@@ -0,0 +1,44 @@
+#ifndef _HASH_AVX2_UTIL_H
+#define _HASH_AVX2_UTIL_H
+
+/*
+ * Helpers shared by the AVX2 multi-buffer kernels, only usable from
+ * translation units compiled with -mavx2.
+ */
+
+#include <immintrin.h>
+
+// Transpose an 8x8 matrix of 32 bit words: r[i] holds 8 words of lane i on entry, word i of every lane on exit
+static inline void transpose8x32(__m256i r[8]) //<<<
+{
+	const __m256i	t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+	const __m256i	t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+	const __m256i	t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+	const __m256i	t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+	const __m256i	t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+	const __m256i	t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+	const __m256i	t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+	const __m256i	t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+	const __m256i	u0 = _mm256_unpacklo_epi64(t0, t2);
+	const __m256i	u1 = _mm256_unpackhi_epi64(t0, t2);
+	const __m256i	u2 = _mm256_unpacklo_epi64(t1, t3);
+	const __m256i	u3 = _mm256_unpackhi_epi64(t1, t3);
+	const __m256i	u4 = _mm256_unpacklo_epi64(t4, t6);
+	const __m256i	u5 = _mm256_unpackhi_epi64(t4, t6);
+	const __m256i	u6 = _mm256_unpacklo_epi64(t5, t7);
+	const __m256i	u7 = _mm256_unpackhi_epi64(t5, t7);
+	r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+	r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+	r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+	r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+	r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+	r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+	r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+	r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+//>>>
+
+#endif
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
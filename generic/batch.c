@@ -0,0 +1,186 @@
+#include "hashInt.h"
+#include <string.h>
+#include "md5.h"
+#include "sha2.h"
+#include "areion.h"
+
+/*
+ * hash::batch: hash every element of a list in one command, through each
+ * algorithm's multi-lane batch kernels, so that short messages don't each
+ * pay for command dispatch, argument conversion and a result object.
+ */
+
+#if defined(__GNUC__)
+#	define PREFETCH(p)	__builtin_prefetch(p)
+#else
+#	define PREFETCH(p)
+#endif
+
+#define PREFETCH_AHEAD	8		// Elements
+
+// Kernel adapters <<<
+static void md5_kernel(size_t count, const uint8_t* const data[], const size_t len[], uint8_t* out)		{md5_batch(count, data, len, (md5_byte_t(*)[16])out);}
+static void sha256_kernel(size_t count, const uint8_t* const data[], const size_t len[], uint8_t* out)	{SHA256_Batch(count, data, len, (uint8_t(*)[SHA256_DIGEST_LENGTH])out);}
+static void sha384_kernel(size_t count, const uint8_t* const data[], const size_t len[], uint8_t* out)	{SHA384_Batch(count, data, len, (uint8_t(*)[SHA384_DIGEST_LENGTH])out);}
+static void sha512_kernel(size_t count, const uint8_t* const data[], const size_t len[], uint8_t* out)	{SHA512_Batch(count, data, len, (uint8_t(*)[SHA512_DIGEST_LENGTH])out);}
+static void dm256_kernel(size_t count, const uint8_t* const data[], const size_t len[], uint8_t* out)	{(void)len; areion_dm_batch(count, data, (uint8_t(*)[32])out, 32);}
+static void dm512_kernel(size_t count, const uint8_t* const data[], const size_t len[], uint8_t* out)	{(void)len; areion_dm_batch(count, data, (uint8_t(*)[32])out, 64);}
+
+static void areion512_md_kernel(size_t count, const uint8_t* const data[], const size_t len[], uint8_t* out) //<<<
+{
+	uint64_t	lens[256];		// The VIL batch takes 64 bit lengths, convert them a chunk at a time
+
+	for (size_t i=0; i<count; i+=256) {
+		const size_t	n = count-i < 256 ? count-i : 256;
+
+		for (size_t j=0; j<n; j++) lens[j] = len[i+j];
+		areion512_md_batch(n, data+i, lens, (uint8_t(*)[32])(out + i*32));
+	}
+}
+
+//>>>
+//>>>
+
+static const struct batch_alg {
+	const char*	name;			// First, for Tcl_GetIndexFromObjStruct
+	size_t		digest_len;
+	size_t		block_len;		// Required length of every element, 0 for any
+	void		(*kernel)(size_t count, const uint8_t* const data[], const size_t len[], uint8_t* out);
+} batch_algs[] = {
+	{"md5",				16,  0, md5_kernel},
+	{"sha256",			32,  0, sha256_kernel},
+	{"sha384",			48,  0, sha384_kernel},
+	{"sha512",			64,  0, sha512_kernel},
+	{"areion512_md",	32,  0, areion512_md_kernel},
+	{"areion256_dm",	32, 32, dm256_kernel},
+	{"areion512_dm",	32, 64, dm512_kernel},
+	{NULL}
+};
+
+static OBJCMD(batch_cmd) //<<<
+{
+	(void)cdata;
+	int					code = TCL_OK;
+	int					algidx, argi;
+	Tcl_Size			count;
+	Tcl_Obj**			ov;
+	const uint8_t**		data = NULL;
+	size_t*				lens = NULL;
+	uint8_t*			digests = NULL;
+	Tcl_Obj**			res = NULL;
+	struct digest_opts	opts = {.format = DIGEST_BINARY};
+
+	TEST_OK_LABEL(finally, code, digest_options(interp, objc, objv, 2, "?-format format? alg messages", DIGEST_OPT_FORMAT, &opts, &argi));
+
+	TEST_OK_LABEL(finally, code, Tcl_GetIndexFromObjStruct(interp, objv[argi], batch_algs, sizeof(batch_algs[0]), "algorithm", TCL_EXACT, &algidx));
+	const struct batch_alg*	alg = &batch_algs[algidx];
+
+	TEST_OK_LABEL(finally, code, Tcl_ListObjGetElements(interp, objv[argi+1], &count, &ov));
+
+	data    = ckalloc(sizeof(data[0]) * (count ? count : 1));
+	lens    = ckalloc(sizeof(lens[0]) * (count ? count : 1));
+	digests = ckalloc(alg->digest_len * (count ? count : 1));
+	res     = ckalloc(sizeof(res[0])  * (count ? count : 1));
+
+	for (Tcl_Size i=0; i<count; i++) {
+		/*
+		 * Prefetch in two stages: the Tcl_Obj further ahead, then the
+		 * bytearray rep it points to (whose header shares a cache line
+		 * with the start of the bytes).  Prefetches don't fault, so it
+		 * doesn't matter if an element isn't a bytearray yet.
+		 */
+		if (i + 2*PREFETCH_AHEAD < count) PREFETCH(ov[i + 2*PREFETCH_AHEAD]);
+		if (i + PREFETCH_AHEAD < count)   PREFETCH(ov[i + PREFETCH_AHEAD]->internalRep.twoPtrValue.ptr1);
+
+		Tcl_Size	len;
+		data[i] = Tcl_GetBytesFromObj(interp, ov[i], &len);
+		if (data[i] == NULL) {code = TCL_ERROR; goto finally;}
+		if (alg->block_len && (size_t)len != alg->block_len)
+			THROW_PRINTF_LABEL(finally, code, "block must be %d bytes long", (int)alg->block_len);
+		lens[i] = len;
+	}
+
+	alg->kernel(count, data, lens, digests);
+
+	for (Tcl_Size i=0; i<count; i++)
+		res[i] = digest_obj(digests + i*alg->digest_len, alg->digest_len, opts.format);
+	Tcl_SetObjResult(interp, Tcl_NewListObj(count, res));
+
+finally:
+	if (data)		ckfree(data);
+	if (lens)		ckfree(lens);
+	if (digests)	ckfree(digests);
+	if (res)		ckfree(res);
+	return code;
+}
+
+//>>>
+/*
+ * Fixed size records packed in one bytearray: the kernels read them in
+ * place and write the digests straight into the result, a chunk of records
+ * at a time so the only per-record state is on the stack.
+ */
+static OBJCMD(records_cmd) //<<<
+{
+	(void)cdata;
+	int				code = TCL_OK;
+	int				algidx;
+	Tcl_WideInt		stride;
+	Tcl_Size		len;
+	Tcl_Obj*		res = NULL;
+
+	enum {A_cmd, A_ALG, A_STRIDE, A_BYTES, A_objc};
+	CHECK_ARGS_LABEL(finally, code, "alg stride bytes");
+
+	TEST_OK_LABEL(finally, code, Tcl_GetIndexFromObjStruct(interp, objv[A_ALG], batch_algs, sizeof(batch_algs[0]), "algorithm", TCL_EXACT, &algidx));
+	const struct batch_alg*	alg = &batch_algs[algidx];
+
+	TEST_OK_LABEL(finally, code, Tcl_GetWideIntFromObj(interp, objv[A_STRIDE], &stride));
+	if (stride <= 0)
+		THROW_ERROR_LABEL(finally, code, "stride must be positive");
+	if (alg->block_len && (size_t)stride != alg->block_len)
+		THROW_PRINTF_LABEL(finally, code, "block must be %d bytes long", (int)alg->block_len);
+
+	const uint8_t*	bytes = Tcl_GetBytesFromObj(interp, objv[A_BYTES], &len);
+	if (bytes == NULL) {code = TCL_ERROR; goto finally;}
+	if (len % stride != 0)
+		THROW_ERROR_LABEL(finally, code, "length of bytes is not a multiple of the stride");
+
+	const size_t	count = len / stride;
+	if (count > TCL_SIZE_MAX / alg->digest_len)
+		THROW_ERROR_LABEL(finally, code, "too many records: the digests would be too long for a byte array");
+	replace_tclobj(&res, Tcl_NewByteArrayObj(NULL, count * alg->digest_len));
+	uint8_t*		out = Tcl_GetBytesFromObj(NULL, res, NULL);
+
+	for (size_t i=0; i<count; i+=256) {
+		const uint8_t*	data[256];
+		size_t			lens[256];
+		const size_t	n = count-i < 256 ? count-i : 256;
+
+		for (size_t j=0; j<n; j++) {
+			data[j] = bytes + (i+j)*stride;
+			lens[j] = stride;
+		}
+		alg->kernel(n, data, lens, out + i*alg->digest_len);
+	}
+
+	Tcl_SetObjResult(interp, res);
+
+finally:
+	release_tclobj(&res);
+	return code;
+}
+
+//>>>
+
+int batch_init(Tcl_Interp* interp) //<<<
+{
+	Tcl_CreateObjCommand(interp, NS "::batch",		batch_cmd,		NULL, NULL);
+	Tcl_CreateObjCommand(interp, NS "::records",	records_cmd,	NULL, NULL);
+
+	return TCL_OK;
+}
+
+//>>>
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
@@ -0,0 +1,246 @@
+#include "hashInt.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * hash::channel: hash what can be read from a channel a fixed size chunk at
+ * a time, so the memory used doesn't depend on how much there is.  A
+ * channel can only be used from the thread that owns it, so the reads stay
+ * on this thread, and with threads it's the hashing that moves to a worker
+ * instead: while the worker hashes one buffer the next is read into the
+ * other.  Input that fits in the first chunk is hashed inline, without
+ * starting a thread.
+ */
+
+#define CHANNEL_CHUNK	(1 << 20)		// Bytes per buffer, of the two
+#define CHANNEL_ALIGN	4096
+
+struct pipeline {
+	struct hash_ctx*	ctx;
+	uint8_t*			buf[2];
+	size_t				len[2];
+	int					full[2];		// buf[i] holds len[i] bytes waiting to be hashed
+	int					eof;			// No more buffers are coming
+	int					threaded;		// The worker is running, else buffers are hashed inline
+#if TCL_THREADS
+	Tcl_ThreadId		worker;
+	Tcl_Mutex			mutex;
+	Tcl_Condition		cond;			// full[] or eof changed
+#endif
+};
+
+#if TCL_THREADS
+static Tcl_ThreadCreateType hash_worker(ClientData cdata) //<<<
+{
+	struct pipeline*	p = cdata;
+
+	for (int i=0;; i^=1) {
+		Tcl_MutexLock(&p->mutex);
+		while (!p->full[i] && !p->eof)
+			Tcl_ConditionWait(&p->cond, &p->mutex, NULL);
+		const int	have = p->full[i];
+		Tcl_MutexUnlock(&p->mutex);
+
+		if (!have) break;
+		hash_update(p->ctx, p->buf[i], p->len[i]);
+
+		Tcl_MutexLock(&p->mutex);
+		p->full[i] = 0;
+		Tcl_ConditionNotify(&p->cond);
+		Tcl_MutexUnlock(&p->mutex);
+	}
+
+	TCL_THREAD_CREATE_RETURN;
+}
+
+//>>>
+#endif
+static void pipeline_start(struct pipeline* p) //<<<
+{
+#if TCL_THREADS
+	// If there's no thread to be had, the buffers are just hashed inline
+	p->threaded = Tcl_CreateThread(&p->worker, hash_worker, p, TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE) == TCL_OK;
+#else
+	(void)p;
+#endif
+}
+
+//>>>
+// Wait for buf[i] to be hashed, and return it to be filled again
+static uint8_t* pipeline_buf(struct pipeline* p, int i) //<<<
+{
+#if TCL_THREADS
+	if (p->threaded) {
+		Tcl_MutexLock(&p->mutex);
+		while (p->full[i])
+			Tcl_ConditionWait(&p->cond, &p->mutex, NULL);
+		Tcl_MutexUnlock(&p->mutex);
+	}
+#endif
+	return p->buf[i];
+}
+
+//>>>
+static void pipeline_push(struct pipeline* p, int i, size_t len) //<<<
+{
+#if TCL_THREADS
+	if (p->threaded) {
+		Tcl_MutexLock(&p->mutex);
+		p->len[i]  = len;
+		p->full[i] = 1;
+		Tcl_ConditionNotify(&p->cond);
+		Tcl_MutexUnlock(&p->mutex);
+		return;
+	}
+#endif
+	hash_update(p->ctx, p->buf[i], len);
+}
+
+//>>>
+// Let the worker finish what it has been given and wait for it to exit, once or again
+static void pipeline_finish(struct pipeline* p) //<<<
+{
+#if TCL_THREADS
+	if (p->threaded) {
+		int		result;
+
+		Tcl_MutexLock(&p->mutex);
+		p->eof = 1;
+		Tcl_ConditionNotify(&p->cond);
+		Tcl_MutexUnlock(&p->mutex);
+
+		Tcl_JoinThread(p->worker, &result);
+		p->threaded = 0;
+	}
+	Tcl_ConditionFinalize(&p->cond);
+	Tcl_MutexFinalize(&p->mutex);
+#else
+	(void)p;
+#endif
+}
+
+//>>>
+static int read_error(Tcl_Interp* interp, Tcl_Channel chan) //<<<
+{
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf("error reading \"%s\": %s", Tcl_GetChannelName(chan), Tcl_PosixError(interp)));
+	return TCL_ERROR;
+}
+
+//>>>
+// Skip offset bytes of chan, by seeking where it can and by reading them where it can't
+static int skip_input(Tcl_Interp* interp, Tcl_Channel chan, Tcl_WideInt offset, uint8_t* buf) //<<<
+{
+	const Tcl_WideInt	pos = Tcl_Tell(chan);
+
+	if (pos >= 0) {
+		const Tcl_WideInt	end = Tcl_Seek(chan, 0, SEEK_END);
+
+		if (end >= 0) {
+			if (offset > end - pos) {
+				Tcl_Seek(chan, pos, SEEK_SET);
+				THROW_ERROR("-offset and -length are past the end of the data");
+			}
+			if (Tcl_Seek(chan, pos + offset, SEEK_SET) < 0) return read_error(interp, chan);
+			return TCL_OK;
+		}
+	}
+
+	while (offset) {
+		const Tcl_Size	got = Tcl_Read(chan, (char*)buf, offset < CHANNEL_CHUNK ? offset : CHANNEL_CHUNK);
+
+		if (got < 0) return read_error(interp, chan);
+		if (got == 0) THROW_ERROR("-offset and -length are past the end of the data");
+		offset -= got;
+	}
+
+	return TCL_OK;
+}
+
+//>>>
+static OBJCMD(channel_cmd) //<<<
+{
+	(void)cdata;
+	int					code = TCL_OK;
+	int					argi, mode, started = 0;
+	enum hash_alg_id	alg;
+	Tcl_Channel			chan;
+	Tcl_DString			blocking;
+	struct digest_opts	opts = {.format = DIGEST_BINARY};
+	struct pipeline		p = {0};
+	void*				mem = NULL;
+	uint64_t			left;
+	uint8_t				digest[64];
+
+	Tcl_DStringInit(&blocking);
+
+	TEST_OK_LABEL(finally, code, digest_options(interp, objc, objv, 2, "?-format format? ?-length length? ?-offset offset? alg channel", DIGEST_OPT_FORMAT|DIGEST_OPT_RANGE, &opts, &argi));
+	TEST_OK_LABEL(finally, code, hash_get_alg(interp, objv[argi], &alg));
+
+	chan = Tcl_GetChannel(interp, Tcl_GetString(objv[argi+1]), &mode);
+	if (chan == NULL) {code = TCL_ERROR; goto finally;}
+	if (!(mode & TCL_READABLE))
+		THROW_ERROR_LABEL(finally, code, "channel \"", Tcl_GetString(objv[argi+1]), "\" wasn't opened for reading");
+
+	// A non-blocking channel would have us spin on short reads
+	TEST_OK_LABEL(finally, code, Tcl_GetChannelOption(interp, chan, "-blocking", &blocking));
+	if (strcmp(Tcl_DStringValue(&blocking), "0") == 0)
+		THROW_ERROR_LABEL(finally, code, "channel \"", Tcl_GetString(objv[argi+1]), "\" must be blocking");
+
+	mem      = ckalloc(2*CHANNEL_CHUNK + CHANNEL_ALIGN);
+	p.buf[0] = (uint8_t*)(((uintptr_t)mem + CHANNEL_ALIGN-1) & ~(uintptr_t)(CHANNEL_ALIGN-1));
+	p.buf[1] = p.buf[0] + CHANNEL_CHUNK;
+
+	if (opts.offset)
+		TEST_OK_LABEL(finally, code, skip_input(interp, chan, opts.offset, p.buf[0]));
+
+	p.ctx = hash_begin(alg);
+	left  = opts.length == -1 ? UINT64_MAX : (uint64_t)opts.length;
+
+	for (int i=0; left; i^=1) {
+		const size_t	want = left < CHANNEL_CHUNK ? left : CHANNEL_CHUNK;
+		const Tcl_Size	got  = Tcl_Read(chan, (char*)pipeline_buf(&p, i), want);
+
+		if (got < 0) {
+			code = read_error(interp, chan);
+			goto finally;
+		}
+		left -= got;
+
+		// Only worth a thread once there's more than one chunk
+		if (!started && (size_t)got == want && left) {
+			pipeline_start(&p);
+			started = 1;
+		}
+
+		if (got) pipeline_push(&p, i, got);
+		if ((size_t)got < want) break;		// Blocking, so that's the end
+	}
+	pipeline_finish(&p);
+
+	if (opts.length != -1 && left)
+		THROW_ERROR_LABEL(finally, code, "-offset and -length are past the end of the data");
+
+	const size_t	digest_len = hash_end(p.ctx, digest);
+	p.ctx = NULL;
+	Tcl_SetObjResult(interp, digest_obj(digest, digest_len, opts.format));
+
+finally:
+	pipeline_finish(&p);
+	if (p.ctx) hash_end(p.ctx, NULL);
+	if (mem) ckfree(mem);
+	Tcl_DStringFree(&blocking);
+	return code;
+}
+
+//>>>
+
+int channel_init(Tcl_Interp* interp) //<<<
+{
+	Tcl_CreateObjCommand(interp, NS "::channel", channel_cmd, NULL, NULL);
+
+	return TCL_OK;
+}
+
+//>>>
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
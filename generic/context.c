@@ -0,0 +1,758 @@
+#include "hashInt.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "md5.h"
+#include "sha2.h"
+#include "areion.h"
+#include "encode.h"
+
+/*
+ * Streaming hash state for every algorithm, behind one Tcl_ObjType.  The
+ * algorithm's native context lives in a ckalloc'd hash_ctx hanging off the
+ * internal rep, so updates go straight into it with no bytearray shimmering,
+ * and the string rep is a serialisation of the state:
+ *
+ *   <alg> <chaining state hex> <total_len> <buffered bytes hex, or {}>
+ *
+ * with the chaining state in the algorithm's own byte order (little endian
+ * words for MD5, big endian for SHA-2), so a context survives shimmering and
+ * can be saved as a string and restored later, even on another host.
+ */
+
+struct hash_alg;
+
+typedef struct hash_ctx {
+	const struct hash_alg*	alg;
+	union {
+		md5_state_t		md5;
+		SHA256_CTX		sha256;
+		SHA512_CTX		sha512;		// Also SHA-384
+		vil_context		vil;
+	} u;
+} hash_ctx;
+
+struct hash_alg {
+	const char*		name;			// First, for Tcl_GetIndexFromObjStruct
+	size_t			digest_len;
+	size_t			state_len;		// Bytes of chaining state in the string rep
+	size_t			block_len;		// The buffered tail is total_len % block_len bytes
+
+	void		(*init)(hash_ctx* ctx);
+	void		(*update)(hash_ctx* ctx, const uint8_t* data, size_t len);
+	void		(*final)(hash_ctx* ctx, uint8_t* digest);		// Clobbers ctx, finalise a copy
+
+	// Return the total length, with the chaining state in state and the buffered tail in *buffer
+	uint64_t	(*save)(const hash_ctx* ctx, uint8_t* state, const uint8_t** buffer);
+	void		(*load)(hash_ctx* ctx, const uint8_t* state, uint64_t total_len, const uint8_t* buffer);
+};
+
+#define CTX_MAX_STATE	64
+
+// Byte order helpers <<<
+static inline void put_le32(uint8_t* p, uint32_t v) //<<<
+{
+	p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+//>>>
+static inline uint32_t get_le32(const uint8_t* p) //<<<
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+//>>>
+static inline void put_be32(uint8_t* p, uint32_t v) //<<<
+{
+	p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+//>>>
+static inline uint32_t get_be32(const uint8_t* p) //<<<
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+//>>>
+static inline void put_be64(uint8_t* p, uint64_t v) //<<<
+{
+	put_be32(p, v >> 32);
+	put_be32(p+4, v);
+}
+
+//>>>
+static inline uint64_t get_be64(const uint8_t* p) //<<<
+{
+	return (uint64_t)get_be32(p) << 32 | get_be32(p+4);
+}
+
+//>>>
+//>>>
+// MD5 <<<
+static void md5_ctx_init(hash_ctx* ctx) //<<<
+{
+	md5_init(&ctx->u.md5);
+}
+
+//>>>
+static void md5_ctx_update(hash_ctx* ctx, const uint8_t* data, size_t len) //<<<
+{
+	md5_append(&ctx->u.md5, data, len);
+}
+
+//>>>
+static void md5_ctx_final(hash_ctx* ctx, uint8_t* digest) //<<<
+{
+	md5_finish(&ctx->u.md5, digest);
+}
+
+//>>>
+static uint64_t md5_ctx_save(const hash_ctx* ctx, uint8_t* state, const uint8_t** buffer) //<<<
+{
+	const md5_state_t*	s = &ctx->u.md5;
+
+	for (int i=0; i<4; i++) put_le32(state + i*4, s->abcd[i]);
+	*buffer = s->buf;
+	return ((uint64_t)s->count[1] << 32 | s->count[0]) >> 3;
+}
+
+//>>>
+static void md5_ctx_load(hash_ctx* ctx, const uint8_t* state, uint64_t total_len, const uint8_t* buffer) //<<<
+{
+	md5_state_t*	s = &ctx->u.md5;
+
+	for (int i=0; i<4; i++) s->abcd[i] = get_le32(state + i*4);
+	s->count[0] = (md5_word_t)(total_len << 3);
+	s->count[1] = (md5_word_t)(total_len >> 29);
+	memcpy(s->buf, buffer, total_len % 64);
+}
+
+//>>>
+//>>>
+// SHA-2 <<<
+static void sha256_ctx_init(hash_ctx* ctx)										{SHA256_Init(&ctx->u.sha256);}
+static void sha256_ctx_update(hash_ctx* ctx, const uint8_t* data, size_t len)	{SHA256_Update(&ctx->u.sha256, data, len);}
+static void sha256_ctx_final(hash_ctx* ctx, uint8_t* digest)					{SHA256_Final(digest, &ctx->u.sha256);}
+static void sha384_ctx_init(hash_ctx* ctx)										{SHA384_Init(&ctx->u.sha512);}
+static void sha384_ctx_update(hash_ctx* ctx, const uint8_t* data, size_t len)	{SHA384_Update(&ctx->u.sha512, data, len);}
+static void sha384_ctx_final(hash_ctx* ctx, uint8_t* digest)					{SHA384_Final(digest, &ctx->u.sha512);}
+static void sha512_ctx_init(hash_ctx* ctx)										{SHA512_Init(&ctx->u.sha512);}
+static void sha512_ctx_update(hash_ctx* ctx, const uint8_t* data, size_t len)	{SHA512_Update(&ctx->u.sha512, data, len);}
+static void sha512_ctx_final(hash_ctx* ctx, uint8_t* digest)					{SHA512_Final(digest, &ctx->u.sha512);}
+
+static uint64_t sha256_ctx_save(const hash_ctx* ctx, uint8_t* state, const uint8_t** buffer) //<<<
+{
+	const SHA256_CTX*	s = &ctx->u.sha256;
+
+	for (int i=0; i<8; i++) put_be32(state + i*4, s->state[i]);
+	*buffer = s->buffer;
+	return s->bitcount >> 3;
+}
+
+//>>>
+static void sha256_ctx_load(hash_ctx* ctx, const uint8_t* state, uint64_t total_len, const uint8_t* buffer) //<<<
+{
+	SHA256_CTX*	s = &ctx->u.sha256;
+
+	for (int i=0; i<8; i++) s->state[i] = get_be32(state + i*4);
+	s->bitcount = total_len << 3;
+	memcpy(s->buffer, buffer, total_len % 64);
+}
+
+//>>>
+static uint64_t sha512_ctx_save(const hash_ctx* ctx, uint8_t* state, const uint8_t** buffer) //<<<
+{
+	const SHA512_CTX*	s = &ctx->u.sha512;
+
+	for (int i=0; i<8; i++) put_be64(state + i*8, s->state[i]);
+	*buffer = s->buffer;
+	return s->bitcount[0] >> 3 | s->bitcount[1] << 61;
+}
+
+//>>>
+static void sha512_ctx_load(hash_ctx* ctx, const uint8_t* state, uint64_t total_len, const uint8_t* buffer) //<<<
+{
+	SHA512_CTX*	s = &ctx->u.sha512;
+
+	for (int i=0; i<8; i++) s->state[i] = get_be64(state + i*8);
+	s->bitcount[0] = total_len << 3;
+	s->bitcount[1] = total_len >> 61;
+	memcpy(s->buffer, buffer, total_len % 128);
+}
+
+//>>>
+//>>>
+// Areion-512 MD <<<
+static void vil_ctx_init(hash_ctx* ctx)										{areion512_md_init(&ctx->u.vil);}
+static void vil_ctx_update(hash_ctx* ctx, const uint8_t* data, size_t len)	{areion512_md_update(&ctx->u.vil, data, len);}
+static void vil_ctx_final(hash_ctx* ctx, uint8_t* digest)					{areion512_md_final(&ctx->u.vil, digest);}
+
+static uint64_t vil_ctx_save(const hash_ctx* ctx, uint8_t* state, const uint8_t** buffer) //<<<
+{
+	memcpy(state, ctx->u.vil.state, 32);
+	*buffer = ctx->u.vil.buffer;
+	return ctx->u.vil.total_len;
+}
+
+//>>>
+static void vil_ctx_load(hash_ctx* ctx, const uint8_t* state, uint64_t total_len, const uint8_t* buffer) //<<<
+{
+	vil_context*	s = &ctx->u.vil;
+
+	memcpy(s->state, state, 32);
+	s->total_len  = total_len;
+	s->buffer_len = total_len % 32;
+	memcpy(s->buffer, buffer, s->buffer_len);
+}
+
+//>>>
+//>>>
+
+static const struct hash_alg hash_algs[] = {
+	[HASH_MD5]			= {"md5",			16, 16,  64, md5_ctx_init,		md5_ctx_update,		md5_ctx_final,		md5_ctx_save,		md5_ctx_load},
+	[HASH_SHA256]		= {"sha256",		32, 32,  64, sha256_ctx_init,	sha256_ctx_update,	sha256_ctx_final,	sha256_ctx_save,	sha256_ctx_load},
+	[HASH_SHA384]		= {"sha384",		48, 64, 128, sha384_ctx_init,	sha384_ctx_update,	sha384_ctx_final,	sha512_ctx_save,	sha512_ctx_load},
+	[HASH_SHA512]		= {"sha512",		64, 64, 128, sha512_ctx_init,	sha512_ctx_update,	sha512_ctx_final,	sha512_ctx_save,	sha512_ctx_load},
+	[HASH_AREION512_MD]	= {"areion512_md",	32, 32,  32, vil_ctx_init,		vil_ctx_update,		vil_ctx_final,		vil_ctx_save,		vil_ctx_load},
+	{NULL}
+};
+
+// -encoding utf-8 <<<
+/*
+ * Feed the string rep str to ctx as standard UTF-8, without first copying it
+ * out through encoding convertto.  Tcl's internal form only differs in
+ * writing NUL as C0 80 and, for Tcl 8.6, characters beyond the BMP as a
+ * CESU-8 surrogate pair (ED A0-AF xx ED B0-BF xx), so the runs between
+ * those are passed straight through and only they are rewritten.
+ */
+static void ctx_update_utf8(hash_ctx* ctx, const char* str, size_t len) //<<<
+{
+	const uint8_t*	p   = (const uint8_t*)str;
+	const uint8_t*	end = p + len;
+	const uint8_t*	run = p;
+
+	while (p < end) {
+		uint8_t		fixed[4];
+		size_t		fixed_len, skip;
+
+		if (*p == 0xC0 && end - p >= 2 && p[1] == 0x80) {
+			fixed[0]  = 0;
+			fixed_len = 1;
+			skip      = 2;
+		} else if (
+			*p == 0xED && end - p >= 6 &&
+			(p[1] & 0xF0) == 0xA0 && p[3] == 0xED && (p[4] & 0xF0) == 0xB0
+		) {
+			const uint32_t	hi = (p[1] & 0x0F) << 6 | (p[2] & 0x3F);		// Less 0xD800
+			const uint32_t	lo = (p[4] & 0x0F) << 6 | (p[5] & 0x3F);		// Less 0xDC00
+			const uint32_t	c  = 0x10000 + (hi << 10 | lo);
+
+			fixed[0]  = 0xF0 | c >> 18;
+			fixed[1]  = 0x80 | (c >> 12 & 0x3F);
+			fixed[2]  = 0x80 | (c >> 6 & 0x3F);
+			fixed[3]  = 0x80 | (c & 0x3F);
+			fixed_len = 4;
+			skip      = 6;
+		} else {
+			p++;
+			continue;
+		}
+
+		if (p > run) ctx->alg->update(ctx, run, p - run);
+		ctx->alg->update(ctx, fixed, fixed_len);
+		p  += skip;
+		run = p;
+	}
+	if (p > run) ctx->alg->update(ctx, run, p - run);
+}
+
+//>>>
+/*
+ * Hash the concatenation of the opts->parts values in parts, as bytes (or
+ * with opts->utf8 the UTF-8 of their string reps), or just the range of it
+ * given by opts->offset and opts->length, without joining or copying them.
+ */
+int hash_parts(Tcl_Interp* interp, enum hash_alg_id alg, Tcl_Obj*const parts[], const struct digest_opts* opts, uint8_t* digest) //<<<
+{
+	hash_ctx	ctx = {.alg = &hash_algs[alg]};
+	uint64_t	skip = opts->offset;
+	uint64_t	left = opts->length == -1 ? UINT64_MAX : (uint64_t)opts->length;
+
+	ctx.alg->init(&ctx);
+	for (int i=0; i<opts->parts; i++) {
+		Tcl_Size	len;
+
+		if (opts->utf8) {
+			const char*	str = Tcl_GetStringFromObj(parts[i], &len);
+			ctx_update_utf8(&ctx, str, len);
+			continue;
+		}
+
+		const uint8_t*	bytes = Tcl_GetBytesFromObj(interp, parts[i], &len);
+		if (bytes == NULL) return TCL_ERROR;
+
+		if (skip >= (uint64_t)len) {
+			skip -= len;
+			continue;
+		}
+		bytes += skip;
+		len   -= skip;
+		skip   = 0;
+		if ((uint64_t)len > left) len = left;
+		ctx.alg->update(&ctx, bytes, len);
+		left -= len;
+	}
+	if (skip || (opts->length != -1 && left))
+		THROW_ERROR("-offset and -length are past the end of the data");
+
+	ctx.alg->final(&ctx, digest);
+	return TCL_OK;
+}
+
+//>>>
+//>>>
+// Tcl_ObjType <<<
+static void free_ctx_intrep(Tcl_Obj* obj);
+static void dup_ctx_intrep(Tcl_Obj* src, Tcl_Obj* dup);
+static void update_ctx_string(Tcl_Obj* obj);
+static int set_ctx_from_any(Tcl_Interp* interp, Tcl_Obj* obj);
+
+static Tcl_ObjType ctx_objtype = {
+	"hash::context",
+	free_ctx_intrep,
+	dup_ctx_intrep,
+	update_ctx_string,
+	set_ctx_from_any
+};
+
+// Decode len hex digits from str into out, returns 0 if any aren't hex digits
+static int hex_decode(uint8_t* out, const char* str, size_t len) //<<<
+{
+	for (size_t i=0; i<len; i++) {
+		const char	c = str[i];
+		int			v;
+
+		if      (c >= '0' && c <= '9') v = c - '0';
+		else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F') v = c - 'A' + 10;
+		else return 0;
+
+		if (i & 1)	out[i/2] |= v;
+		else		out[i/2]  = v << 4;
+	}
+	return 1;
+}
+
+//>>>
+static hash_ctx* new_ctx(const struct hash_alg* alg) //<<<
+{
+	hash_ctx*	ctx = ckalloc(sizeof(*ctx));
+
+	ctx->alg = alg;
+	alg->init(ctx);
+	return ctx;
+}
+
+//>>>
+static Tcl_Obj* new_ctx_obj(hash_ctx* ctx) //<<<
+{
+	Tcl_Obj*	res = Tcl_NewObj();
+
+	Tcl_StoreInternalRep(res, &ctx_objtype, &(Tcl_ObjInternalRep){.twoPtrValue.ptr1 = ctx});
+	Tcl_InvalidateStringRep(res);
+	return res;
+}
+
+//>>>
+static void free_ctx_intrep(Tcl_Obj* obj) //<<<
+{
+	Tcl_ObjInternalRep*	ir = Tcl_FetchInternalRep(obj, &ctx_objtype);
+
+	if (ir) {
+		ckfree(ir->twoPtrValue.ptr1);
+		ir->twoPtrValue.ptr1 = NULL;
+	}
+}
+
+//>>>
+static void dup_ctx_intrep(Tcl_Obj* src, Tcl_Obj* dup) //<<<
+{
+	const hash_ctx*	ctx  = Tcl_FetchInternalRep(src, &ctx_objtype)->twoPtrValue.ptr1;
+	hash_ctx*		copy = ckalloc(sizeof(*copy));
+
+	*copy = *ctx;
+	Tcl_StoreInternalRep(dup, &ctx_objtype, &(Tcl_ObjInternalRep){.twoPtrValue.ptr1 = copy});
+}
+
+//>>>
+static void update_ctx_string(Tcl_Obj* obj) //<<<
+{
+	const hash_ctx*			ctx = Tcl_FetchInternalRep(obj, &ctx_objtype)->twoPtrValue.ptr1;
+	const struct hash_alg*	alg = ctx->alg;
+	uint8_t					state[CTX_MAX_STATE];
+	const uint8_t*			buffer;
+	char					state_hex[CTX_MAX_STATE*2+1], buffer_hex[128*2+1];
+	char					str[32 + sizeof(state_hex) + 21 + sizeof(buffer_hex)];
+	int						len;
+
+	const uint64_t	total_len  = alg->save(ctx, state, &buffer);
+	const size_t	buffer_len = total_len % alg->block_len;
+
+	encode_hex(state_hex,  state,  alg->state_len);
+	encode_hex(buffer_hex, buffer, buffer_len);
+	state_hex[alg->state_len*2] = buffer_hex[buffer_len*2] = 0;
+	len = snprintf(str, sizeof(str), "%s %s %" PRIu64 " %s", alg->name, state_hex, total_len, buffer_len ? buffer_hex : "{}");
+
+	Tcl_InitStringRep(obj, str, len);
+}
+
+//>>>
+static int set_ctx_from_any(Tcl_Interp* interp, Tcl_Obj* obj) //<<<
+{
+	int						code = TCL_OK;
+	Tcl_Obj*				parts = NULL;
+	Tcl_Obj**				ov;
+	Tcl_Size				oc, state_len, buffer_len;
+	Tcl_WideInt				total_len;
+	int						algidx;
+	const char*				state;
+	const char*				buffer;
+	const struct hash_alg*	alg;
+	uint8_t					state_bytes[CTX_MAX_STATE], buffer_bytes[128];
+
+	// Parse a copy as a list, rather than shimmering obj
+	replace_tclobj(&parts, Tcl_NewStringObj(Tcl_GetString(obj), -1));
+	if (
+		Tcl_ListObjGetElements(NULL, parts, &oc, &ov) != TCL_OK ||
+		oc != 4 ||
+		Tcl_GetIndexFromObjStruct(NULL, ov[0], hash_algs, sizeof(hash_algs[0]), "algorithm", TCL_EXACT, &algidx) != TCL_OK ||
+		Tcl_GetWideIntFromObj(NULL, ov[2], &total_len) != TCL_OK ||
+		total_len < 0 ||
+		(uint64_t)total_len > UINT64_MAX >> 3		// The bit count has to fit the length fields
+	) goto invalid;
+
+	alg    = &hash_algs[algidx];
+	state  = Tcl_GetStringFromObj(ov[1], &state_len);
+	buffer = Tcl_GetStringFromObj(ov[3], &buffer_len);
+	if (
+		state_len != (Tcl_Size)alg->state_len * 2 ||
+		buffer_len != (Tcl_Size)(total_len % alg->block_len) * 2 ||
+		!hex_decode(state_bytes,  state,  state_len) ||
+		!hex_decode(buffer_bytes, buffer, buffer_len)
+	) goto invalid;
+
+	hash_ctx*	ctx = new_ctx(alg);
+	alg->load(ctx, state_bytes, total_len, buffer_bytes);
+	Tcl_StoreInternalRep(obj, &ctx_objtype, &(Tcl_ObjInternalRep){.twoPtrValue.ptr1 = ctx});
+
+finally:
+	release_tclobj(&parts);
+	return code;
+
+invalid:
+	if (interp) Tcl_SetObjResult(interp, Tcl_ObjPrintf("invalid hash context \"%s\"", Tcl_GetString(obj)));
+	code = TCL_ERROR;
+	goto finally;
+}
+
+//>>>
+// Fetch the context from obj, which must be for alg unless that is NULL
+static int get_ctx(Tcl_Interp* interp, Tcl_Obj* obj, const struct hash_alg* alg, hash_ctx** ctx) //<<<
+{
+	Tcl_ObjInternalRep*	ir = Tcl_FetchInternalRep(obj, &ctx_objtype);
+
+	if (ir == NULL) {
+		TEST_OK(set_ctx_from_any(interp, obj));
+		ir = Tcl_FetchInternalRep(obj, &ctx_objtype);
+	}
+
+	*ctx = ir->twoPtrValue.ptr1;
+	if (alg && (*ctx)->alg != alg)
+		THROW_ERROR("wrong context type ", (*ctx)->alg->name, ", expected ", alg->name);
+
+	return TCL_OK;
+}
+
+//>>>
+/*
+ * Append data, as bytes or with utf8 as the UTF-8 of its string rep, to (or
+ * with data == NULL reset) the context in the variable varname, in place
+ * when the variable holds the only reference, like lappend.
+ */
+static int update_ctx_var(Tcl_Interp* interp, Tcl_Obj* varname, const struct hash_alg* alg, Tcl_Obj* data, int utf8) //<<<
+{
+	int				code = TCL_OK;
+	Tcl_Obj*		ctxobj = NULL;
+	hash_ctx*		ctx;
+	Tcl_Size		len = 0;
+	const uint8_t*	bytes = NULL;
+
+	if (data && !utf8) {
+		bytes = Tcl_GetBytesFromObj(interp, data, &len);
+		if (bytes == NULL) return TCL_ERROR;
+	}
+
+	replace_tclobj(&ctxobj, Tcl_ObjGetVar2(interp, varname, NULL, TCL_LEAVE_ERR_MSG));
+	if (ctxobj == NULL) {code = TCL_ERROR; goto finally;}
+	if (ctxobj->refCount > 2)		// The variable and ours
+		replace_tclobj(&ctxobj, Tcl_DuplicateObj(ctxobj));
+
+	TEST_OK_LABEL(finally, code, get_ctx(interp, ctxobj, alg, &ctx));
+
+	if (data == NULL) {
+		ctx->alg->init(ctx);
+	} else if (utf8) {
+		const char*	str = Tcl_GetStringFromObj(data, &len);
+		ctx_update_utf8(ctx, str, len);
+	} else {
+		ctx->alg->update(ctx, bytes, len);
+	}
+	Tcl_InvalidateStringRep(ctxobj);
+
+	if (Tcl_ObjSetVar2(interp, varname, NULL, ctxobj, TCL_LEAVE_ERR_MSG) == NULL) {
+		code = TCL_ERROR;
+		goto finally;
+	}
+
+finally:
+	release_tclobj(&ctxobj);
+	return code;
+}
+
+//>>>
+// Set the interp result to the digest of everything appended to ctx so far
+static void ctx_digest(Tcl_Interp* interp, const hash_ctx* ctx, enum digest_format format) //<<<
+{
+	hash_ctx	copy = *ctx;		// Finalise a copy, so the context can carry on being updated
+	uint8_t		digest[64];
+
+	ctx->alg->final(&copy, digest);
+	Tcl_SetObjResult(interp, digest_obj(digest, ctx->alg->digest_len, format));
+}
+
+//>>>
+//>>>
+// Generic commands <<<
+static OBJCMD(context_init_cmd) //<<<
+{
+	(void)cdata;
+	int			code = TCL_OK;
+	int			algidx;
+
+	enum {A_cmd, A_ALG, A_objc};
+	CHECK_ARGS_LABEL(finally, code, "alg");
+
+	TEST_OK_LABEL(finally, code, Tcl_GetIndexFromObjStruct(interp, objv[A_ALG], hash_algs, sizeof(hash_algs[0]), "algorithm", TCL_EXACT, &algidx));
+
+	Tcl_SetObjResult(interp, new_ctx_obj(new_ctx(&hash_algs[algidx])));
+
+finally:
+	return code;
+}
+
+//>>>
+static OBJCMD(context_update_cmd) //<<<
+{
+	int						code = TCL_OK;
+	const struct hash_alg*	alg = cdata;		// Set for the algorithm specific aliases
+	struct digest_opts		opts = {0};
+	int						argi = 1;
+
+	// The legacy areion512_md_update alias takes no options
+	if (alg) {
+		enum {A_cmd, A_CTXVAR, A_BYTES, A_objc};
+		CHECK_ARGS_LABEL(finally, code, "ctxVar bytes");
+	} else {
+		TEST_OK_LABEL(finally, code, digest_options(interp, objc, objv, 2, "?-encoding encoding? ctxVar bytes", DIGEST_OPT_ENCODING, &opts, &argi));
+	}
+
+	TEST_OK_LABEL(finally, code, update_ctx_var(interp, objv[argi], alg, objv[argi+1], opts.utf8));
+
+finally:
+	return code;
+}
+
+//>>>
+static OBJCMD(context_digest_cmd) //<<<
+{
+	int						code = TCL_OK;
+	const struct hash_alg*	alg = cdata;
+	hash_ctx*				ctx;
+	struct digest_opts		opts = {.format = DIGEST_BINARY};
+	int						argi = 1;
+
+	// The legacy md5_finish and areion512_md_final aliases take no options
+	if (alg) {
+		enum {A_cmd, A_CTX, A_objc};
+		CHECK_ARGS_LABEL(finally, code, "ctx");
+	} else {
+		TEST_OK_LABEL(finally, code, digest_options(interp, objc, objv, 1, "?-format format? ctx", DIGEST_OPT_FORMAT, &opts, &argi));
+	}
+
+	TEST_OK_LABEL(finally, code, get_ctx(interp, objv[argi], alg, &ctx));
+	ctx_digest(interp, ctx, opts.format);
+
+finally:
+	return code;
+}
+
+//>>>
+static OBJCMD(context_copy_cmd) //<<<
+{
+	(void)cdata;
+	int			code = TCL_OK;
+	hash_ctx*	ctx;
+
+	enum {A_cmd, A_CTX, A_objc};
+	CHECK_ARGS_LABEL(finally, code, "ctx");
+
+	TEST_OK_LABEL(finally, code, get_ctx(interp, objv[A_CTX], NULL, &ctx));
+
+	hash_ctx*	copy = ckalloc(sizeof(*copy));
+	*copy = *ctx;
+	Tcl_SetObjResult(interp, new_ctx_obj(copy));
+
+finally:
+	return code;
+}
+
+//>>>
+static OBJCMD(context_reset_cmd) //<<<
+{
+	(void)cdata;
+	int			code = TCL_OK;
+
+	enum {A_cmd, A_CTXVAR, A_objc};
+	CHECK_ARGS_LABEL(finally, code, "ctxVar");
+
+	TEST_OK_LABEL(finally, code, update_ctx_var(interp, objv[A_CTXVAR], NULL, NULL, 0));
+
+finally:
+	return code;
+}
+
+//>>>
+// Algorithm specific init, with the alg in cdata
+static OBJCMD(alg_init_cmd) //<<<
+{
+	int			code = TCL_OK;
+
+	enum {A_cmd, A_objc};
+	CHECK_ARGS_LABEL(finally, code, "");
+
+	Tcl_SetObjResult(interp, new_ctx_obj(new_ctx(cdata)));
+
+finally:
+	return code;
+}
+
+//>>>
+//>>>
+// Legacy MD5 handles <<<
+/*
+ * hash::md5_append has always updated its handle argument in place rather
+ * than through a variable, so it still does: the context is mutated in the
+ * value's internal rep, and every reference to the value sees the change.
+ * That includes -memo's, so anything memoised for it is dropped.
+ */
+static OBJCMD(md5_append_cmd) //<<<
+{
+	(void)cdata;
+	int			code = TCL_OK;
+	hash_ctx*	ctx;
+
+	enum {A_cmd, A_HANDLE, A_BYTES, A_objc};
+	CHECK_ARGS_LABEL(finally, code, "handle bytes");
+
+	Tcl_Size		len;
+	const uint8_t*	bytes = Tcl_GetBytesFromObj(interp, objv[A_BYTES], &len);
+	if (bytes == NULL) {code = TCL_ERROR; goto finally;}
+
+	TEST_OK_LABEL(finally, code, get_ctx(interp, objv[A_HANDLE], &hash_algs[HASH_MD5], &ctx));
+
+	ctx->alg->update(ctx, bytes, len);
+	Tcl_InvalidateStringRep(objv[A_HANDLE]);
+	memo_forget(interp, objv[A_HANDLE]);		// Digests of the value as it was
+
+finally:
+	return code;
+}
+
+//>>>
+//>>>
+// Streaming API, for data that doesn't arrive as Tcl values <<<
+int hash_get_alg(Tcl_Interp* interp, Tcl_Obj* obj, enum hash_alg_id* alg) //<<<
+{
+	int		algidx;
+
+	TEST_OK(Tcl_GetIndexFromObjStruct(interp, obj, hash_algs, sizeof(hash_algs[0]), "algorithm", TCL_EXACT, &algidx));
+	*alg = algidx;
+	return TCL_OK;
+}
+
+//>>>
+struct hash_ctx* hash_begin(enum hash_alg_id alg) //<<<
+{
+	return new_ctx(&hash_algs[alg]);
+}
+
+//>>>
+void hash_update(struct hash_ctx* ctx, const uint8_t* data, size_t len) //<<<
+{
+	ctx->alg->update(ctx, data, len);
+}
+
+//>>>
+// The digest of what ctx has been given so far, leaving it to carry on
+size_t hash_digest(const struct hash_ctx* ctx, uint8_t* digest) //<<<
+{
+	hash_ctx	copy = *ctx;
+
+	ctx->alg->final(&copy, digest);
+	return ctx->alg->digest_len;
+}
+
+//>>>
+const char* hash_name(enum hash_alg_id alg) //<<<
+{
+	return hash_algs[alg].name;
+}
+
+//>>>
+size_t hash_end(struct hash_ctx* ctx, uint8_t* digest) //<<<
+{
+	const size_t	digest_len = ctx->alg->digest_len;
+
+	if (digest) ctx->alg->final(ctx, digest);
+	ckfree(ctx);
+	return digest_len;
+}
+
+//>>>
+//>>>
+
+int context_init(Tcl_Interp* interp) //<<<
+{
+	const struct hash_alg*	md5  = &hash_algs[HASH_MD5];
+	const struct hash_alg*	vil  = &hash_algs[HASH_AREION512_MD];
+
+	Tcl_CreateObjCommand(interp, NS "::context_init",		context_init_cmd,	NULL, NULL);
+	Tcl_CreateObjCommand(interp, NS "::context_update",		context_update_cmd,	NULL, NULL);
+	Tcl_CreateObjCommand(interp, NS "::context_digest",		context_digest_cmd,	NULL, NULL);
+	Tcl_CreateObjCommand(interp, NS "::context_copy",		context_copy_cmd,	NULL, NULL);
+	Tcl_CreateObjCommand(interp, NS "::context_reset",		context_reset_cmd,	NULL, NULL);
+
+	Tcl_CreateObjCommand(interp, NS "::md5_init",			alg_init_cmd,		(ClientData)md5, NULL);
+	Tcl_CreateObjCommand(interp, NS "::md5_append",			md5_append_cmd,		NULL, NULL);
+	Tcl_CreateObjCommand(interp, NS "::md5_finish",			context_digest_cmd,	(ClientData)md5, NULL);
+
+	Tcl_CreateObjCommand(interp, NS "::areion512_md_init",		alg_init_cmd,		(ClientData)vil, NULL);
+	Tcl_CreateObjCommand(interp, NS "::areion512_md_update",	context_update_cmd,	(ClientData)vil, NULL);
+	Tcl_CreateObjCommand(interp, NS "::areion512_md_final",		context_digest_cmd,	(ClientData)vil, NULL);
+
+	return TCL_OK;
+}
+
+//>>>
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
@@ -0,0 +1,72 @@
+#include "hashInt.h"
+#include "cpu.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#	include <cpuid.h>
+#	ifndef bit_VAES
+#		define bit_VAES	(1 << 9)
+#	endif
+#elif defined(__aarch64__) && defined(__linux__)
+#	include <sys/auxv.h>
+#	include <asm/hwcap.h>
+#endif
+
+unsigned int	cpu_features = 0;
+
+#if defined(__x86_64__) || defined(__i386__)
+static unsigned long long xgetbv0(void) //<<<
+{
+	unsigned int	eax, edx;
+
+	__asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long)edx << 32) | eax;
+}
+
+//>>>
+#endif
+
+TCL_DECLARE_MUTEX(cpu_detect_mutex)
+
+void cpu_detect(void) //<<<
+{
+	static int		detected = 0;
+	unsigned int	features = 0;
+
+	Tcl_MutexLock(&cpu_detect_mutex);
+	if (detected) goto done;
+
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned int	eax, ebx, ecx, edx;
+	int				os_ymm = 0;
+
+	if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+		if (ecx & bit_SSSE3)	features |= CPU_SSSE3;
+		if (ecx & bit_SSE4_1)	features |= CPU_SSE41;
+		if (ecx & bit_AES)		features |= CPU_AES;
+		// The AVX family is only usable if the OS saves the XMM and YMM state on context switches
+		if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX))
+			os_ymm = (xgetbv0() & 0x6) == 0x6;
+	}
+	if (__get_cpuid_max(0, NULL) >= 7 && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+		if (ebx & bit_SHA)				features |= CPU_SHA;
+		if (os_ymm && (ebx & bit_AVX2))	features |= CPU_AVX2;
+		if (ebx & bit_BMI2)				features |= CPU_BMI2;
+		if (os_ymm && (ecx & bit_VAES))	features |= CPU_VAES;
+	}
+#elif defined(__aarch64__) && defined(__linux__)
+	if (getauxval(AT_HWCAP) & HWCAP_AES)	features |= CPU_NEON_AES;
+#elif defined(__aarch64__) && (defined(__APPLE__) || defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+	// All Apple silicon has the crypto extensions, elsewhere trust the baseline target
+	features |= CPU_NEON_AES;
+#endif
+
+	cpu_features = features;
+	detected = 1;
+
+done:
+	Tcl_MutexUnlock(&cpu_detect_mutex);
+}
+
+//>>>
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
@@ -0,0 +1,30 @@
+#ifndef _HASH_CPU_H
+#define _HASH_CPU_H
+
+/*
+ * Runtime CPU feature detection.  The instruction set specific kernels are
+ * each compiled in their own translation unit with their own ISA flags, and
+ * the library picks between them at load time based on what the host CPU
+ * actually supports, so a single build runs everywhere.
+ */
+
+enum cpu_feature {
+	CPU_SSE41		= 1 << 0,		// x86 SSE4.1
+	CPU_AES			= 1 << 1,		// x86 AES-NI
+	CPU_SHA			= 1 << 2,		// x86 SHA extensions (SHA-NI)
+	CPU_AVX2		= 1 << 3,		// x86 AVX2, with the OS saving the YMM state
+	CPU_BMI2		= 1 << 4,		// x86 BMI2 (rorx, shrx, ...)
+	CPU_VAES		= 1 << 5,		// x86 VAES (AES on 256 bit registers), with the OS saving the YMM state
+	CPU_SSSE3		= 1 << 6,		// x86 SSSE3 (pshufb)
+	CPU_NEON_AES	= 1 << 16,		// aarch64 crypto extensions (AESE/AESMC)
+};
+
+extern unsigned int	cpu_features;
+
+void cpu_detect(void);
+
+#define CPU_HAS(mask)	((cpu_features & (mask)) == (mask))
+
+#endif
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
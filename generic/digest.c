@@ -0,0 +1,239 @@
+#include "hashInt.h"
+#include <string.h>
+#include "encode.h"
+
+/*
+ * Digests as returned by the digest commands.  The binary format is a
+ * plain bytearray.  The text formats keep the raw digest as the internal
+ * rep and only encode it, straight into the string rep, when something
+ * asks for the string: results that are stored and compared through our
+ * own commands, or just dropped, never pay for the encoding.  The value is
+ * the encoded string as always, so anything that wants it as a bytearray
+ * (binary decode hex, say) sees the characters.
+ */
+
+const char* const digest_format_names[] = {"binary", "hex", "base64", "base64url", NULL};
+
+struct digest_rep {
+	enum digest_format	format;
+	size_t				len;
+	uint8_t				bytes[];
+};
+
+static void free_digest_intrep(Tcl_Obj* obj);
+static void dup_digest_intrep(Tcl_Obj* src, Tcl_Obj* dup);
+static void update_digest_string(Tcl_Obj* obj);
+
+static Tcl_ObjType digest_objtype = {
+	"hash::digest",
+	free_digest_intrep,
+	dup_digest_intrep,
+	update_digest_string,
+	NULL		// Only ever created from a digest, never parsed
+};
+
+static struct digest_rep* new_digest_rep(enum digest_format format, const uint8_t* bytes, size_t len) //<<<
+{
+	struct digest_rep*	rep = ckalloc(sizeof(*rep) + len);
+
+	rep->format = format;
+	rep->len    = len;
+	memcpy(rep->bytes, bytes, len);
+	return rep;
+}
+
+//>>>
+static void free_digest_intrep(Tcl_Obj* obj) //<<<
+{
+	Tcl_ObjInternalRep*	ir = Tcl_FetchInternalRep(obj, &digest_objtype);
+
+	if (ir) {
+		ckfree(ir->twoPtrValue.ptr1);
+		ir->twoPtrValue.ptr1 = NULL;
+	}
+}
+
+//>>>
+static void dup_digest_intrep(Tcl_Obj* src, Tcl_Obj* dup) //<<<
+{
+	const struct digest_rep*	rep = Tcl_FetchInternalRep(src, &digest_objtype)->twoPtrValue.ptr1;
+
+	Tcl_StoreInternalRep(dup, &digest_objtype, &(Tcl_ObjInternalRep){.twoPtrValue.ptr1 = new_digest_rep(rep->format, rep->bytes, rep->len)});
+}
+
+//>>>
+static void update_digest_string(Tcl_Obj* obj) //<<<
+{
+	const struct digest_rep*	rep = Tcl_FetchInternalRep(obj, &digest_objtype)->twoPtrValue.ptr1;
+	const int					url = rep->format == DIGEST_BASE64URL;
+
+	switch (rep->format) {
+		case DIGEST_HEX:
+			encode_hex(Tcl_InitStringRep(obj, NULL, rep->len*2), rep->bytes, rep->len);
+			break;
+
+		case DIGEST_BASE64:
+		case DIGEST_BASE64URL:
+			encode_base64(Tcl_InitStringRep(obj, NULL, BASE64_LEN(rep->len, url)), rep->bytes, rep->len, url);
+			break;
+
+		default:
+			Tcl_Panic("hash::digest with format %d has no string rep", rep->format);
+	}
+}
+
+//>>>
+Tcl_Obj* digest_obj(const uint8_t* bytes, size_t len, enum digest_format format) //<<<
+{
+	if (format == DIGEST_BINARY)
+		return Tcl_NewByteArrayObj(bytes, len);
+
+	Tcl_Obj*	res = Tcl_NewObj();
+
+	Tcl_StoreInternalRep(res, &digest_objtype, &(Tcl_ObjInternalRep){.twoPtrValue.ptr1 = new_digest_rep(format, bytes, len)});
+	Tcl_InvalidateStringRep(res);
+	return res;
+}
+
+//>>>
+/*
+ * Parse the leading options of a digest command, those of ?-batch?,
+ * ?-binary? (the same as -format binary), ?-direct?, ?-encoding encoding?,
+ * ?-format format?, ?-kernel?, ?-length length?, ?-manifest?, ?-memo? and
+ * ?-offset offset? that flags allows, in any order, leaving *argi at the first of the nargs fixed
+ * arguments that must follow them.  Only arguments before those are taken
+ * as options, so data that happens to look like one is still hashed, and
+ * values without a string rep are never taken for options.  With
+ * DIGEST_OPT_PARTS the last fixed argument may be repeated, options end at
+ * the first argument that doesn't start with - (or after --), and
+ * opts->parts is set to the number given.  opts->format is left alone
+ * unless given, so set it to the command's default first.
+ */
+int digest_options(Tcl_Interp* interp, int objc, Tcl_Obj*const objv[], int nargs, const char* usage, int flags, struct digest_opts* opts, int* argi) //<<<
+{
+	enum {OPT_BATCH, OPT_BINARY, OPT_DIRECT, OPT_ENCODING, OPT_FORMAT, OPT_KERNEL, OPT_LENGTH, OPT_MANIFEST, OPT_MEMO, OPT_OFFSET, OPT_END};
+	static const struct {
+		const char*	name;
+		int			flag;		// The flag that allows it
+		int			id;
+	} options[] = {
+		{"-batch",		DIGEST_OPT_BATCH,		OPT_BATCH},
+		{"-binary",		DIGEST_OPT_BINARY,		OPT_BINARY},
+		{"-direct",		DIGEST_OPT_DIRECT,		OPT_DIRECT},
+		{"-encoding",	DIGEST_OPT_ENCODING,	OPT_ENCODING},
+		{"-format",		DIGEST_OPT_FORMAT,		OPT_FORMAT},
+		{"-kernel",		DIGEST_OPT_KERNEL,		OPT_KERNEL},
+		{"-length",		DIGEST_OPT_RANGE,		OPT_LENGTH},
+		{"-manifest",	DIGEST_OPT_MANIFEST,	OPT_MANIFEST},
+		{"-memo",		DIGEST_OPT_MEMO,		OPT_MEMO},
+		{"-offset",		DIGEST_OPT_RANGE,		OPT_OFFSET},
+		{"--",			DIGEST_OPT_PARTS,		OPT_END},
+	};
+	static const char* const	encodings[] = {"binary", "utf-8", NULL};
+	const int					noptions = sizeof(options) / sizeof(options[0]);
+	int							i, o, idx;
+	Tcl_WideInt					w;
+
+	if (objc < 1 + nargs) goto wrongargs;
+
+	opts->batch = opts->memo = opts->utf8 = opts->direct = opts->kernel = opts->manifest = 0;
+	opts->offset = 0;
+	opts->length = -1;
+	for (i=1; i < objc - nargs; i++) {
+		/*
+		 * A value with no string rep, like a bytearray read from a file,
+		 * can't have been written as an option, and generating one just to
+		 * look at its first character would copy all of it
+		 */
+		const char*	arg = Tcl_HasStringRep(objv[i]) ? Tcl_GetString(objv[i]) : NULL;
+
+		if (arg == NULL || arg[0] != '-') {
+			// The data starts here, or there are too many arguments
+			if (flags & DIGEST_OPT_PARTS) break;
+			goto wrongargs;
+		}
+
+		for (o=0; o<noptions; o++)
+			if ((flags & options[o].flag) && strcmp(arg, options[o].name) == 0)
+				break;
+
+		if (o == noptions) {
+			// Worded like Tcl_GetIndexFromObj's, listing only the options this command takes
+			Tcl_Obj*	msg = Tcl_ObjPrintf("bad option \"%s\": must be ", arg);
+			int			n = 0, listed = 0;
+
+			for (o=0; o<noptions; o++) n += (flags & options[o].flag) != 0;
+			for (o=0; o<noptions; o++) {
+				if (!(flags & options[o].flag)) continue;
+				if (listed++) Tcl_AppendToObj(msg, n > 2 ? ", " : " ", -1);
+				if (listed == n && n > 1) Tcl_AppendToObj(msg, "or ", -1);
+				Tcl_AppendToObj(msg, options[o].name, -1);
+			}
+			Tcl_SetObjResult(interp, msg);
+			Tcl_SetErrorCode(interp, "TCL", "LOOKUP", "INDEX", "option", arg, NULL);
+			return TCL_ERROR;
+		}
+
+		switch (options[o].id) {
+			case OPT_BATCH:		opts->batch    = 1;				break;
+			case OPT_BINARY:	opts->format   = DIGEST_BINARY;	break;
+			case OPT_DIRECT:	opts->direct   = 1;				break;
+			case OPT_KERNEL:	opts->kernel   = 1;				break;
+			case OPT_MANIFEST:	opts->manifest = 1;				break;
+			case OPT_MEMO:		opts->memo     = 1;				break;
+
+			case OPT_ENCODING:
+				if (++i >= objc - nargs) goto wrongargs;
+				TEST_OK(Tcl_GetIndexFromObj(interp, objv[i], encodings, "encoding", TCL_EXACT, &idx));
+				opts->utf8 = idx == 1;
+				break;
+
+			case OPT_FORMAT:
+				if (++i >= objc - nargs) goto wrongargs;
+				TEST_OK(Tcl_GetIndexFromObj(interp, objv[i], digest_format_names, "format", TCL_EXACT, &idx));
+				opts->format = idx;
+				break;
+
+			case OPT_LENGTH:
+			case OPT_OFFSET:
+				if (++i >= objc - nargs) goto wrongargs;
+				TEST_OK(Tcl_GetWideIntFromObj(interp, objv[i], &w));
+				if (w < 0) THROW_ERROR(arg, " can't be negative");
+				if (options[o].id == OPT_LENGTH)	opts->length = w;
+				else								opts->offset = w;
+				break;
+
+			case OPT_END:
+				i++;
+				goto done;
+		}
+	}
+done:
+	*argi = i;
+	opts->parts = objc - i - (nargs - 1);
+	if (opts->parts < 1) goto wrongargs;
+
+	if (opts->batch) {
+		if (opts->parts > 1) goto wrongargs;
+		if (opts->memo)
+			THROW_ERROR("-memo can't be used with -batch");
+		if (opts->utf8)
+			THROW_ERROR("-encoding utf-8 can't be used with -batch");
+		if (opts->offset || opts->length != -1)
+			THROW_ERROR("-offset and -length can't be used with -batch");
+	}
+	if (opts->utf8 && (opts->offset || opts->length != -1))
+		THROW_ERROR("-offset and -length can't be used with -encoding utf-8");
+	if (opts->memo && (opts->parts > 1 || opts->offset || opts->length != -1))
+		THROW_ERROR("-memo can only be used with a single whole data argument");
+
+	return TCL_OK;
+
+wrongargs:
+	Tcl_WrongNumArgs(interp, 1, objv, usage);
+	return TCL_ERROR;
+}
+
+//>>>
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
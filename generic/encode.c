@@ -0,0 +1,128 @@
+#include "hashInt.h"
+#include "encode.h"
+#include "cpu.h"
+
+/*
+ * Portable hex and base64 encoders, and the runtime selection between them
+ * and the SIMD versions in encode_ssse3.c and encode_avx2.c.
+ */
+
+static const char	hex_digits[]			= "0123456789abcdef";
+static const char	base64_alphabet[]		= "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char	base64url_alphabet[]	= "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+void encode_hex_portable(char* out, const uint8_t* in, size_t len) //<<<
+{
+	for (size_t i=0; i<len; i++) {
+		out[i*2]   = hex_digits[in[i] >> 4];
+		out[i*2+1] = hex_digits[in[i] & 0xf];
+	}
+}
+
+//>>>
+size_t encode_base64_portable(char* out, const uint8_t* in, size_t len, int url) //<<<
+{
+	const char*	alphabet = url ? base64url_alphabet : base64_alphabet;
+	char*		o = out;
+	size_t		i = 0;
+
+	for (; i+3 <= len; i += 3) {
+		const uint32_t	w = (uint32_t)in[i] << 16 | (uint32_t)in[i+1] << 8 | in[i+2];
+
+		*o++ = alphabet[w >> 18];
+		*o++ = alphabet[w >> 12 & 0x3f];
+		*o++ = alphabet[w >>  6 & 0x3f];
+		*o++ = alphabet[w       & 0x3f];
+	}
+
+	if (i < len) {
+		const uint32_t	w = (uint32_t)in[i] << 16 | (i+1 < len ? (uint32_t)in[i+1] << 8 : 0);
+
+		*o++ = alphabet[w >> 18];
+		*o++ = alphabet[w >> 12 & 0x3f];
+		if (i+1 < len)	*o++ = alphabet[w >> 6 & 0x3f];
+		else if (!url)	*o++ = '=';
+		if (!url)		*o++ = '=';
+	}
+
+	return o - out;
+}
+
+//>>>
+
+const struct encode_impl encode_impl_portable = {
+	.name		= "portable",
+	.requires	= 0,
+	.hex		= encode_hex_portable,
+	.base64		= encode_base64_portable,
+};
+
+const struct encode_impl* const encode_impls[] = {
+#if HAVE_AVX2
+	&encode_impl_avx2,
+#endif
+#if HAVE_SSSE3
+	&encode_impl_ssse3,
+#endif
+	&encode_impl_portable,
+};
+const size_t encode_impls_count = sizeof(encode_impls) / sizeof(encode_impls[0]);
+
+const char* const encode_op_names[ENCODE_OP_COUNT] = {
+	"hex", "base64"
+};
+
+static const struct encode_impl*	encode_installed[ENCODE_OP_COUNT] = {
+	&encode_impl_portable, &encode_impl_portable
+};
+
+static int encode_provides(const struct encode_impl* impl, enum encode_op op) //<<<
+{
+	switch (op) {
+		case ENCODE_OP_HEX:		return impl->hex != NULL;
+		case ENCODE_OP_BASE64:	return impl->base64 != NULL;
+		default:				return 0;
+	}
+}
+
+//>>>
+void encode_select(const struct encode_impl* impl) //<<<
+{
+	for (int op=0; op<ENCODE_OP_COUNT; op++) {
+		encode_installed[op] = &encode_impl_portable;
+
+		if (impl != NULL) {
+			if (encode_provides(impl, op)) encode_installed[op] = impl;
+			continue;
+		}
+
+		for (size_t i=0; i<encode_impls_count; i++) {
+			if (CPU_HAS(encode_impls[i]->requires) && encode_provides(encode_impls[i], op)) {
+				encode_installed[op] = encode_impls[i];
+				break;
+			}
+		}
+	}
+}
+
+//>>>
+const struct encode_impl* encode_current(enum encode_op op) //<<<
+{
+	return encode_installed[op];
+}
+
+//>>>
+void encode_hex(char* out, const uint8_t* in, size_t len) //<<<
+{
+	encode_installed[ENCODE_OP_HEX]->hex(out, in, len);
+}
+
+//>>>
+size_t encode_base64(char* out, const uint8_t* in, size_t len, int url) //<<<
+{
+	return encode_installed[ENCODE_OP_BASE64]->base64(out, in, len, url);
+}
+
+//>>>
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
@@ -0,0 +1,63 @@
+#ifndef _HASH_ENCODE_H
+#define _HASH_ENCODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Text encoders for digests.  Like the hash kernels, the SIMD versions each
+ * live in their own translation unit compiled with the ISA flags they need,
+ * and digest.c installs the best the host CPU supports at init time.
+ *
+ * hex writes len*2 lower case hex digits to out.  base64 writes the
+ * base64 encoding of in, with the standard alphabet and = padding, or with
+ * url set the base64url alphabet (RFC 4648 section 5) and no padding, and
+ * returns the number of characters written.  Neither NUL terminates out.
+ * A NULL entry means the implementation doesn't provide that encoder.
+ */
+struct encode_impl {
+	const char*		name;
+	unsigned int	requires;		// Mask of enum cpu_feature bits this implementation needs
+
+	void	(*hex)(char* out, const uint8_t* in, size_t len);
+	size_t	(*base64)(char* out, const uint8_t* in, size_t len, int url);
+};
+
+enum encode_op {
+	ENCODE_OP_HEX,
+	ENCODE_OP_BASE64,
+	ENCODE_OP_COUNT
+};
+
+extern const struct encode_impl	encode_impl_avx2;
+extern const struct encode_impl	encode_impl_ssse3;
+extern const struct encode_impl	encode_impl_portable;
+
+extern const struct encode_impl* const	encode_impls[];		// In order of preference, portable last
+extern const size_t						encode_impls_count;
+
+extern const char* const	encode_op_names[ENCODE_OP_COUNT];
+
+/*
+ * Install impl for each encoder it provides (the portable ones for the
+ * rest), or with impl == NULL the best the host CPU supports for each.
+ * Call after cpu_detect().
+ */
+void encode_select(const struct encode_impl* impl);
+
+const struct encode_impl* encode_current(enum encode_op op);
+
+// Through whichever encoders are installed
+void   encode_hex(char* out, const uint8_t* in, size_t len);
+size_t encode_base64(char* out, const uint8_t* in, size_t len, int url);
+
+// The portable encoders, for the SIMD ones to finish off their tails with
+void   encode_hex_portable(char* out, const uint8_t* in, size_t len);
+size_t encode_base64_portable(char* out, const uint8_t* in, size_t len, int url);
+
+// Characters base64 (url == 0) or base64url (url != 0) produces for len bytes
+#define BASE64_LEN(len, url)	((url) ? ((len)*4 + 2) / 3 : ((len) + 2) / 3 * 4)
+
+#endif
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
@@ -0,0 +1,47 @@
+/*
+ * AVX2 hex encoder for digests, 32 bytes at a time.  Compiled with -mavx2,
+ * only called when the host CPU reports AVX2.  There is no AVX2 base64:
+ * digests are at most 64 bytes, which the SSSE3 encoder already covers in
+ * a handful of steps.
+ */
+
+#include "encode.h"
+#include "cpu.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+static void avx2_hex(char* out, const uint8_t* in, size_t len) //<<<
+{
+	const __m256i	digits = _mm256_setr_epi8(
+		'0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f',
+		'0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f');
+	const __m256i	nibble = _mm256_set1_epi8(0x0f);
+	size_t			i = 0;
+
+	for (; i+32 <= len; i += 32) {
+		const __m256i	v  = _mm256_loadu_si256((const __m256i*)(in + i));
+		const __m256i	hi = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+		const __m256i	lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(v, nibble));
+		// The unpacks work within each 128 bit lane: a is bytes 0-7 and 16-23, b 8-15 and 24-31
+		const __m256i	a  = _mm256_unpacklo_epi8(hi, lo);
+		const __m256i	b  = _mm256_unpackhi_epi8(hi, lo);
+
+		_mm256_storeu_si256((__m256i*)(out + i*2),      _mm256_permute2x128_si256(a, b, 0x20));
+		_mm256_storeu_si256((__m256i*)(out + i*2 + 32), _mm256_permute2x128_si256(a, b, 0x31));
+	}
+
+	encode_hex_portable(out + i*2, in + i, len - i);
+}
+
+//>>>
+
+const struct encode_impl encode_impl_avx2 = {
+	.name		= "avx2",
+	.requires	= CPU_AVX2,
+	.hex		= avx2_hex,
+	.base64		= NULL,
+};
+#endif
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
@@ -0,0 +1,69 @@
+/*
+ * SSSE3 hex and base64 encoders for digests.  Compiled with -mssse3, only
+ * called when the host CPU reports SSSE3.  The base64 encoder is Wojciech
+ * Muła's pshufb method: spread each 3 input bytes over 4 bytes, pull the
+ * 6 bit fields apart with a multiply, then turn the indices into
+ * characters with a 16 entry table of offsets.
+ */
+
+#include "encode.h"
+#include "cpu.h"
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+
+static void ssse3_hex(char* out, const uint8_t* in, size_t len) //<<<
+{
+	const __m128i	digits = _mm_setr_epi8('0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f');
+	const __m128i	nibble = _mm_set1_epi8(0x0f);
+	size_t			i = 0;
+
+	for (; i+16 <= len; i += 16) {
+		const __m128i	v  = _mm_loadu_si128((const __m128i*)(in + i));
+		const __m128i	hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+		const __m128i	lo = _mm_shuffle_epi8(digits, _mm_and_si128(v, nibble));
+
+		_mm_storeu_si128((__m128i*)(out + i*2),      _mm_unpacklo_epi8(hi, lo));
+		_mm_storeu_si128((__m128i*)(out + i*2 + 16), _mm_unpackhi_epi8(hi, lo));
+	}
+
+	encode_hex_portable(out + i*2, in + i, len - i);
+}
+
+//>>>
+static size_t ssse3_base64(char* out, const uint8_t* in, size_t len, int url) //<<<
+{
+	const __m128i	spread = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+	const __m128i	shift  = url ?
+		_mm_setr_epi8('a'-26, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '-'-62, '_'-63, 'A', 0, 0) :
+		_mm_setr_epi8('a'-26, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '+'-62, '/'-63, 'A', 0, 0);
+	size_t			i = 0, o = 0;
+
+	// 12 bytes in, 16 characters out, reading 16 so stop while there are that many left
+	for (; i+16 <= len; i += 12, o += 16) {
+		const __m128i	v  = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + i)), spread);
+		const __m128i	t0 = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+		const __m128i	t1 = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+		const __m128i	idx = _mm_or_si128(t0, t1);
+
+		// 0-25 -> 13, 26-51 -> 0, 52-61 -> 1-10, 62 -> 11, 63 -> 12
+		__m128i			sel = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+		sel = _mm_or_si128(sel, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), idx), _mm_set1_epi8(13)));
+
+		_mm_storeu_si128((__m128i*)(out + o), _mm_add_epi8(idx, _mm_shuffle_epi8(shift, sel)));
+	}
+
+	return o + encode_base64_portable(out + o, in + i, len - i, url);
+}
+
+//>>>
+
+const struct encode_impl encode_impl_ssse3 = {
+	.name		= "ssse3",
+	.requires	= CPU_SSSE3,
+	.hex		= ssse3_hex,
+	.base64		= ssse3_base64,
+};
+#endif
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
@@ -0,0 +1,320 @@
+#define _GNU_SOURCE		// For splice and O_DIRECT
+#include "hashInt.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if HAVE_AF_ALG
+#include <sys/socket.h>
+#include <linux/if_alg.h>
+#endif
+
+/*
+ * hash::path: hash a local file, or a range of it, straight out of the page
+ * cache (it isn't hash::file so that hash::* can be imported alongside
+ * ::file).  A regular file is mapped a window at a time and the mapping is
+ * handed to the hash as it is, so its bytes are never copied into a buffer
+ * of ours (or through a channel's).  What can't be mapped, like pipes,
+ * devices and the files in /proc that say they're empty, or anything mmap
+ * refuses, is read with pread (or read, where there's no seeking) into a
+ * buffer instead.  As with anything that maps files, one truncated by
+ * another process while it's being hashed raises SIGBUS.
+ *
+ * With -kernel the hashing is done by the kernel's own implementation, on an
+ * AF_ALG hash socket, and the file's pages are spliced through a pipe into
+ * it, so they never enter user space at all.  Only the algorithms the kernel
+ * has (md5 and the SHA-2 family, not areion512_md) can be hashed that way,
+ * and kernels or sandboxes that don't allow AF_ALG sockets raise an error
+ * rather than quietly hashing in process.  Whether it's faster depends on
+ * the kernel's implementations and the CPU: it saves the mapping, but not
+ * the hashing, and can't use this package's SHA-NI or AVX2 kernels.
+ */
+
+#define FILE_WINDOW		((size_t)1 << 28)		// Bytes mapped at a time, a whole number of huge pages
+#define FILE_HUGEPAGE	((size_t)1 << 21)		// Below this MADV_HUGEPAGE can't help
+#define FILE_CHUNK		(1 << 20)				// Bytes per read when it can't be mapped
+
+static int file_error(Tcl_Interp* interp, const char* what, Tcl_Obj* path) //<<<
+{
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf("%s \"%s\": %s", what, Tcl_GetString(path), Tcl_PosixError(interp)));
+	return TCL_ERROR;
+}
+
+//>>>
+/*
+ * Open a file to be hashed, leaving *size at its length if it's a regular
+ * file that says how long it is, else 0.  With direct, the reads are asked
+ * to go around the page cache: O_DIRECT where the filesystem allows it,
+ * F_NOCACHE on Darwin, and only a plain open where there's neither.
+ * Returns the fd, or -1 with errno set.
+ */
+int file_open(const char* native, int direct, uint64_t* size) //<<<
+{
+	struct stat	st;
+	int			fd;
+
+#ifdef O_DIRECT
+	fd = open(native, O_RDONLY | O_CLOEXEC | (direct ? O_DIRECT : 0));
+	if (fd == -1 && direct && errno == EINVAL)
+		fd = open(native, O_RDONLY | O_CLOEXEC);		// The filesystem can't do O_DIRECT, so the page cache it is
+#else
+	fd = open(native, O_RDONLY | O_CLOEXEC);
+#	ifdef F_NOCACHE
+	if (fd != -1 && direct) (void)fcntl(fd, F_NOCACHE, 1);		// Only a hint, like O_DIRECT's fallback
+#	endif
+#endif
+	if (fd == -1) return -1;
+
+	if (fstat(fd, &st) == -1) {
+		const int	err = errno;
+
+		close(fd);
+		errno = err;
+		return -1;
+	}
+
+	// Files in /proc and the like claim to be empty, so only a non-zero size is believed
+	*size = S_ISREG(st.st_mode) && st.st_size > 0 ? (uint64_t)st.st_size : 0;
+
+	return fd;
+}
+
+//>>>
+// Hash a window of at most FILE_WINDOW bytes at pos, returning the bytes hashed or 0 if it couldn't be mapped
+static size_t hash_mapped(struct hash_ctx* ctx, int fd, uint64_t pos, uint64_t left, size_t pagesize) //<<<
+{
+	const uint64_t	start = pos & ~(uint64_t)(pagesize-1);		// mmap offsets must be page aligned
+	const size_t	skew  = pos - start;
+	const size_t	len   = left + skew < FILE_WINDOW ? left + skew : FILE_WINDOW;
+	uint8_t*		map   = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, start);
+
+	if (map == MAP_FAILED) return 0;
+
+	// Only hints, there's nothing to be done if the kernel doesn't take them
+	(void)madvise(map, len, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+	if (len >= FILE_HUGEPAGE) (void)madvise(map, len, MADV_HUGEPAGE);
+#endif
+
+	hash_update(ctx, map + skew, len - skew);
+	munmap(map, len);
+
+	return len - skew;
+}
+
+//>>>
+#if HAVE_AF_ALG
+static int kernel_error(Tcl_Interp* interp, const char* what) //<<<
+{
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf("%s: %s", what, Tcl_PosixError(interp)));
+	return TCL_ERROR;
+}
+
+//>>>
+// Hash left bytes of fd from *pos in the kernel, leaving *pos and *left at where it stopped, and the digest in digest
+static int hash_kernel(Tcl_Interp* interp, enum hash_alg_id alg, int fd, Tcl_Obj* path, int seekable, uint64_t* pos, uint64_t* left, uint8_t* digest, size_t* digest_len) //<<<
+{
+	int					code = TCL_OK;
+	int					tfm = -1, op = -1, pipefd[2] = {-1, -1};
+	int					spliceable = 1;
+	uint8_t*			buf = NULL;
+	struct sockaddr_alg	sa = {.salg_family = AF_ALG, .salg_type = "hash"};
+	ssize_t				got;
+
+	if (alg == HASH_AREION512_MD)
+		THROW_ERROR_LABEL(finally, code, "the kernel has no ", hash_name(alg), " hasher");
+
+	strncpy((char*)sa.salg_name, hash_name(alg), sizeof(sa.salg_name) - 1);
+	tfm = socket(AF_ALG, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (tfm == -1 || bind(tfm, (struct sockaddr*)&sa, sizeof(sa)) == -1 || (op = accept4(tfm, NULL, 0, SOCK_CLOEXEC)) == -1) {
+		Tcl_SetObjResult(interp, Tcl_ObjPrintf("couldn't open the kernel's %s hasher: %s", hash_name(alg), Tcl_PosixError(interp)));
+		code = TCL_ERROR;
+		goto finally;
+	}
+
+	if (pipe2(pipefd, O_CLOEXEC) == -1) {code = kernel_error(interp, "couldn't create a pipe"); goto finally;}
+	(void)fcntl(pipefd[1], F_SETPIPE_SZ, FILE_CHUNK);		// Fewer, larger splices, where that is allowed
+
+	while (*left) {
+		const size_t	want = *left < FILE_CHUNK ? *left : FILE_CHUNK;
+
+		if (spliceable) {
+			loff_t	off = *pos;
+
+			// Into the pipe, and on from there to the hasher (MORE: the hash doesn't end with this chunk)
+			got = splice(fd, seekable ? &off : NULL, pipefd[1], NULL, want, SPLICE_F_MOVE);
+			if (got == -1 && errno == EINTR) continue;
+			if (got == -1 && errno == EINVAL) {
+				spliceable = 0;		// The pipe is empty, so the rest can be sent from a buffer instead
+				continue;
+			}
+			if (got == -1) {code = file_error(interp, "error reading", path); goto finally;}
+			if (got == 0) break;
+
+			for (ssize_t sent, unsent = got; unsent; unsent -= sent) {
+				sent = splice(pipefd[0], NULL, op, NULL, unsent, SPLICE_F_MOVE | SPLICE_F_MORE);
+				if (sent == -1 && errno == EINTR) {sent = 0; continue;}
+				if (sent == -1) {code = kernel_error(interp, "error hashing in the kernel"); goto finally;}
+			}
+		} else {
+			if (buf == NULL) buf = ckalloc(FILE_CHUNK);
+
+			got = seekable ? pread(fd, buf, want, *pos) : read(fd, buf, want);
+			if (got == -1 && errno == EINTR) continue;
+			if (got == -1) {code = file_error(interp, "error reading", path); goto finally;}
+			if (got == 0) break;
+
+			for (ssize_t sent, unsent = got; unsent; unsent -= sent) {
+				sent = send(op, buf + got - unsent, unsent, MSG_MORE);
+				if (sent == -1 && errno == EINTR) {sent = 0; continue;}
+				if (sent == -1) {code = kernel_error(interp, "error hashing in the kernel"); goto finally;}
+			}
+		}
+
+		*pos  += got;
+		*left -= got;
+	}
+
+	// Reading the result ends the hash
+	do got = read(op, digest, 64); while (got == -1 && errno == EINTR);
+	if (got == -1) {code = kernel_error(interp, "error hashing in the kernel"); goto finally;}
+	*digest_len = got;
+
+finally:
+	if (buf) ckfree(buf);
+	if (pipefd[0] != -1) close(pipefd[0]);
+	if (pipefd[1] != -1) close(pipefd[1]);
+	if (op != -1) close(op);
+	if (tfm != -1) close(tfm);
+	return code;
+}
+
+//>>>
+#else
+static int hash_kernel(Tcl_Interp* interp, enum hash_alg_id alg, int fd, Tcl_Obj* path, int seekable, uint64_t* pos, uint64_t* left, uint8_t* digest, size_t* digest_len) //<<<
+{
+	(void)alg; (void)fd; (void)path; (void)seekable; (void)pos; (void)left; (void)digest; (void)digest_len;
+	THROW_ERROR("-kernel isn't supported on this platform");
+}
+
+//>>>
+#endif
+static OBJCMD(file_cmd) //<<<
+{
+	(void)cdata;
+	int					code = TCL_OK;
+	int					argi, fd = -1;
+	enum hash_alg_id	alg;
+	Tcl_Obj*			path;
+	const char*			native;
+	uint64_t			size;
+	struct digest_opts	opts = {.format = DIGEST_BINARY};
+	struct hash_ctx*	ctx = NULL;
+	uint8_t*			buf = NULL;
+	uint64_t			pos, left;
+	int					sized, mappable, seekable;
+	uint8_t				digest[64];
+	size_t				digest_len = 0;
+
+	TEST_OK_LABEL(finally, code, digest_options(interp, objc, objv, 2, "?-format format? ?-kernel? ?-length length? ?-offset offset? alg path", DIGEST_OPT_FORMAT|DIGEST_OPT_KERNEL|DIGEST_OPT_RANGE, &opts, &argi));
+	TEST_OK_LABEL(finally, code, hash_get_alg(interp, objv[argi], &alg));
+	path = objv[argi+1];
+
+	native = Tcl_FSGetNativePath(path);
+	if (native == NULL)
+		THROW_ERROR_LABEL(finally, code, "couldn't open \"", Tcl_GetString(path), "\": not a native file");
+
+	fd = file_open(native, 0, &size);
+	if (fd == -1) {code = file_error(interp, "couldn't open", path); goto finally;}
+
+	sized    = size > 0;
+	mappable = sized;
+	seekable = lseek(fd, 0, SEEK_CUR) != -1;
+
+	if (sized && ((uint64_t)opts.offset > size || (opts.length != -1 && (uint64_t)opts.length > size - opts.offset)))
+		THROW_ERROR_LABEL(finally, code, "-offset and -length are past the end of the data");
+
+	pos  = opts.offset;
+	left = opts.length != -1 ? (uint64_t)opts.length : sized ? size - pos : UINT64_MAX;
+
+	if (!seekable && pos) {
+		// Pipes and the like can only be read past the offset
+		buf = ckalloc(FILE_CHUNK);
+		for (uint64_t skip = pos; skip;) {
+			const ssize_t	got = read(fd, buf, skip < FILE_CHUNK ? skip : FILE_CHUNK);
+
+			if (got == -1 && errno == EINTR) continue;
+			if (got == -1) {code = file_error(interp, "error reading", path); goto finally;}
+			if (got == 0) THROW_ERROR_LABEL(finally, code, "-offset and -length are past the end of the data");
+			skip -= got;
+		}
+	}
+
+	if (seekable && !sized && pos) {
+		// Files in /proc and the like don't say how long they are, so see whether the offset is in them
+		uint8_t	byte;
+		ssize_t	got;
+
+		do got = pread(fd, &byte, 1, pos-1); while (got == -1 && errno == EINTR);
+		if (got == -1) {code = file_error(interp, "error reading", path); goto finally;}
+		if (got == 0) THROW_ERROR_LABEL(finally, code, "-offset and -length are past the end of the data");
+	}
+
+	if (opts.kernel) {
+		TEST_OK_LABEL(finally, code, hash_kernel(interp, alg, fd, path, seekable, &pos, &left, digest, &digest_len));
+	} else {
+		ctx = hash_begin(alg);
+		while (left) {
+			if (mappable) {
+				const size_t	got = hash_mapped(ctx, fd, pos, left, sysconf(_SC_PAGESIZE));
+
+				if (got) {
+					pos  += got;
+					left -= got;
+					continue;
+				}
+				mappable = 0;		// Read the rest instead
+			}
+
+			if (buf == NULL) buf = ckalloc(FILE_CHUNK);
+
+			const size_t	want = left < FILE_CHUNK ? left : FILE_CHUNK;
+			const ssize_t	got  = seekable ? pread(fd, buf, want, pos) : read(fd, buf, want);
+
+			if (got == -1 && errno == EINTR) continue;
+			if (got == -1) {code = file_error(interp, "error reading", path); goto finally;}
+			if (got == 0) break;
+			hash_update(ctx, buf, got);
+			pos  += got;
+			left -= got;
+		}
+		digest_len = hash_end(ctx, digest);
+		ctx = NULL;
+	}
+
+	if (opts.length != -1 && left)
+		THROW_ERROR_LABEL(finally, code, "-offset and -length are past the end of the data");
+
+	Tcl_SetObjResult(interp, digest_obj(digest, digest_len, opts.format));
+
+finally:
+	if (ctx) hash_end(ctx, NULL);
+	if (buf) ckfree(buf);
+	if (fd != -1) close(fd);
+	return code;
+}
+
+//>>>
+
+int file_init(Tcl_Interp* interp) //<<<
+{
+	Tcl_CreateObjCommand(interp, NS "::path", file_cmd, NULL, NULL);
+
+	return TCL_OK;
+}
+
+//>>>
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
@@ -10,8 +10,98 @@
 #include <stdint.h>
 
 #include "tclstuff.h"
+#include "tip445.h"
+
+#ifndef TCL_SIZE_MAX
+#include <limits.h>
+#define TCL_SIZE_MAX	INT_MAX		// Tcl 8.6, where Tcl_Size is int
+#endif
 
 // areon.c internal API
 int areion_init(Tcl_Interp* interp);
 
+// context.c internal API
+enum hash_alg_id {
+	HASH_MD5,
+	HASH_SHA256,
+	HASH_SHA384,
+	HASH_SHA512,
+	HASH_AREION512_MD,
+	HASH_ALG_COUNT
+};
+
+struct digest_opts;
+struct hash_ctx;
+
+int context_init(Tcl_Interp* interp);
+int hash_parts(Tcl_Interp* interp, enum hash_alg_id alg, Tcl_Obj*const parts[], const struct digest_opts* opts, uint8_t* digest);		// The data arguments of a digest command, as opts says
+int hash_get_alg(Tcl_Interp* interp, Tcl_Obj* obj, enum hash_alg_id* alg);
+struct hash_ctx* hash_begin(enum hash_alg_id alg);
+void hash_update(struct hash_ctx* ctx, const uint8_t* data, size_t len);
+size_t hash_digest(const struct hash_ctx* ctx, uint8_t* digest);		// So far, without consuming ctx
+const char* hash_name(enum hash_alg_id alg);
+size_t hash_end(struct hash_ctx* ctx, uint8_t* digest);		// Frees ctx, returning the digest length; with digest == NULL just frees it
+
+// batch.c internal API
+int batch_init(Tcl_Interp* interp);
+
+// channel.c internal API
+int channel_init(Tcl_Interp* interp);
+
+// tap.c internal API
+int tap_init(Tcl_Interp* interp);
+
+// file.c internal API
+int file_init(Tcl_Interp* interp);
+int file_open(const char* native, int direct, uint64_t* size);		// The fd, or -1 and errno; *size is 0 unless the file says how long it is
+
+// paths.c internal API
+int paths_init(Tcl_Interp* interp);
+
+// digest.c internal API
+enum digest_format {
+	DIGEST_BINARY,
+	DIGEST_HEX,
+	DIGEST_BASE64,
+	DIGEST_BASE64URL
+};
+extern const char* const digest_format_names[];		// Indexed by enum digest_format, NULL terminated
+
+enum digest_opt_flags {
+	DIGEST_OPT_BATCH	= 1 << 0,		// Accept -batch
+	DIGEST_OPT_BINARY	= 1 << 1,		// Accept -binary
+	DIGEST_OPT_ENCODING	= 1 << 2,		// Accept -encoding
+	DIGEST_OPT_FORMAT	= 1 << 3,		// Accept -format
+	DIGEST_OPT_MEMO		= 1 << 4,		// Accept -memo
+	DIGEST_OPT_PARTS	= 1 << 5,		// Accept several data arguments and --
+	DIGEST_OPT_RANGE	= 1 << 6,		// Accept -offset and -length
+	DIGEST_OPT_DIRECT	= 1 << 7,		// Accept -direct
+	DIGEST_OPT_MANIFEST	= 1 << 8,		// Accept -manifest
+	DIGEST_OPT_KERNEL	= 1 << 9		// Accept -kernel
+};
+
+struct digest_opts {
+	int					batch;			// -batch given
+	int					memo;			// -memo given
+	int					utf8;			// -encoding utf-8 given: hash the string rep, not the bytes
+	int					direct;			// -direct given: read files around the page cache
+	int					kernel;			// -kernel given: have the kernel's AF_ALG hasher do the hashing
+	int					manifest;		// -manifest given: check files against the digests given for them
+	int					parts;			// The number of data arguments, more than 1 only with DIGEST_OPT_PARTS
+	Tcl_WideInt			offset;			// -offset, or 0
+	Tcl_WideInt			length;			// -length, or -1 for the rest
+	enum digest_format	format;			// Set to the command's default before parsing
+};
+
+Tcl_Obj* digest_obj(const uint8_t* bytes, size_t len, enum digest_format format);
+int digest_options(Tcl_Interp* interp, int objc, Tcl_Obj*const objv[], int nargs, const char* usage, int flags, struct digest_opts* opts, int* argi);
+// A single whole data argument, hashed as bytes
+#define DIGEST_PLAIN(opts)	((opts)->parts == 1 && !(opts)->utf8 && (opts)->offset == 0 && (opts)->length == -1)
+
+// memo.c internal API
+int memo_init(Tcl_Interp* interp);
+int memo_lookup(Tcl_Interp* interp, Tcl_Obj* data, enum hash_alg_id alg, int utf8, uint8_t* digest, size_t len);		// 1 and the digest if cached, else 0
+void memo_store(Tcl_Interp* interp, Tcl_Obj* data, enum hash_alg_id alg, int utf8, const uint8_t* digest, size_t len);
+void memo_forget(Tcl_Interp* interp, Tcl_Obj* data);		// For values changed in place
+
 #endif
@@ -1,216 +1,414 @@
 #include "hashInt.h"
+#include <string.h>
 #include "md5.h"
+#include "md5_impl.h"
 #include "sha2.h"
+#include "sha2_impl.h"
+#include "cpu.h"
+#include "encode.h"
 
-static OBJCMD(glue_md5) //<<<
+static int md5_batch_obj(Tcl_Interp* interp, Tcl_Obj* messages, enum digest_format format) //<<<
 {
-	(void)cdata;
-	md5_byte_t*		bytes;
-	Tcl_Size		len;
-	md5_byte_t		digest[16];
-	md5_state_t		state;
-
-	CHECK_ARGS(1, "data");
+	int						code = TCL_OK;
+	Tcl_Size				count;
+	Tcl_Obj**				ov;
+	const md5_byte_t**		data = NULL;
+	size_t*					lens = NULL;
+	md5_byte_t				(*digests)[16] = NULL;
+	Tcl_Obj*				res = NULL;
+
+	TEST_OK_LABEL(finally, code, Tcl_ListObjGetElements(interp, messages, &count, &ov));
+
+	data    = ckalloc(sizeof(data[0])    * (count ? count : 1));
+	lens    = ckalloc(sizeof(lens[0])    * (count ? count : 1));
+	digests = ckalloc(sizeof(digests[0]) * (count ? count : 1));
+
+	for (Tcl_Size i=0; i<count; i++) {
+		Tcl_Size	len;
+		data[i] = Tcl_GetByteArrayFromObj(ov[i], &len);
+		lens[i] = len;
+	}
 
-	bytes = (md5_byte_t*)Tcl_GetByteArrayFromObj(objv[1], &len);
+	md5_batch(count, data, lens, digests);
 
-	md5_init(&state);
-	md5_append(&state, bytes, len);
-	md5_finish(&state, digest);
+	res = Tcl_NewListObj(count, NULL);
+	for (Tcl_Size i=0; i<count; i++)
+		Tcl_ListObjAppendElement(NULL, res, digest_obj(digests[i], 16, format));
 
-	Tcl_SetObjResult(interp, Tcl_NewByteArrayObj(digest, 16));
+	Tcl_SetObjResult(interp, res);
 
-	return TCL_OK;
+finally:
+	if (data)		ckfree(data);
+	if (lens)		ckfree(lens);
+	if (digests)	ckfree(digests);
+	return code;
 }
 
 //>>>
-static OBJCMD(glue_md5_init) //<<<
+static OBJCMD(glue_md5) //<<<
 {
 	(void)cdata;
-	Tcl_Obj*		res;
-	Tcl_Size		dontcare;
-	md5_state_t*	state;
-
-	CHECK_ARGS(0, "");
-
-	res = Tcl_NewByteArrayObj(NULL, sizeof(md5_state_t));
-	state = (md5_state_t*)Tcl_GetByteArrayFromObj(res, &dontcare);
-
-	md5_init(state);
+	md5_byte_t			digest[16];
+	struct digest_opts	opts = {.format = DIGEST_BINARY};
+	int					argi;
+
+	TEST_OK(digest_options(interp, objc, objv, 1, "?-batch? ?-encoding encoding? ?-format format? ?-length length? ?-memo? ?-offset offset? ?--? data ?data ...?", DIGEST_OPT_BATCH|DIGEST_OPT_ENCODING|DIGEST_OPT_FORMAT|DIGEST_OPT_MEMO|DIGEST_OPT_PARTS|DIGEST_OPT_RANGE, &opts, &argi));
+
+	if (opts.batch)
+		return md5_batch_obj(interp, objv[argi], opts.format);
+
+	if (!opts.memo || !memo_lookup(interp, objv[argi], HASH_MD5, opts.utf8, digest, 16)) {
+		if (!DIGEST_PLAIN(&opts)) {
+			TEST_OK(hash_parts(interp, HASH_MD5, objv+argi, &opts, digest));
+		} else {
+			Tcl_Size		len;
+			md5_byte_t*		bytes = (md5_byte_t*)Tcl_GetByteArrayFromObj(objv[argi], &len);
+			md5_state_t		state;
+
+			md5_init(&state);
+			md5_append(&state, bytes, len);
+			md5_finish(&state, digest);
+		}
+		if (opts.memo) memo_store(interp, objv[argi], HASH_MD5, opts.utf8, digest, 16);
+	}
 
-	Tcl_SetObjResult(interp, res);
+	Tcl_SetObjResult(interp, digest_obj(digest, 16, opts.format));
 
 	return TCL_OK;
 }
 
 //>>>
-static OBJCMD(glue_md5_append) //<<<
+static int sha2_batch(Tcl_Interp* interp, int variant, Tcl_Obj* messages, enum digest_format format) //<<<
 {
-	(void)cdata;
-	Tcl_Size		len, dontcare;
-	md5_state_t*	state;
-	md5_byte_t*		bytes;
-
-	CHECK_ARGS(2, "handle bytes");
-
-	state = (md5_state_t*)Tcl_GetByteArrayFromObj(objv[1], &dontcare);
-	bytes = (md5_byte_t*)Tcl_GetByteArrayFromObj(objv[2], &len);
+	int						code = TCL_OK;
+	Tcl_Size				count;
+	Tcl_Obj**				ov;
+	const unsigned char**	data = NULL;
+	size_t*					lens = NULL;
+	unsigned char*			digests = NULL;
+	size_t					digest_len;
+	Tcl_Obj*				res = NULL;
 
-	md5_append(state, bytes, len);
+	switch (variant) {
+		case 256: digest_len = SHA256_DIGEST_LENGTH; break;
+		case 384: digest_len = SHA384_DIGEST_LENGTH; break;
+		case 512: digest_len = SHA512_DIGEST_LENGTH; break;
+		default:
+			THROW_PRINTF_LABEL(finally, code, "Unsupported SHA-2 variant: %d", variant);
+	}
 
-	return TCL_OK;
-}
+	TEST_OK_LABEL(finally, code, Tcl_ListObjGetElements(interp, messages, &count, &ov));
 
-//>>>
-static OBJCMD(glue_md5_finish) //<<<
-{
-	(void)cdata;
-	Tcl_Size		dontcare;
-	md5_state_t*	state;
-	md5_byte_t		digest[16];
+	data    = ckalloc(sizeof(data[0]) * (count ? count : 1));
+	lens    = ckalloc(sizeof(lens[0]) * (count ? count : 1));
+	digests = ckalloc(digest_len * (count ? count : 1));
 
-	CHECK_ARGS(1, "handle");
+	for (Tcl_Size i=0; i<count; i++) {
+		Tcl_Size	len;
+		data[i] = Tcl_GetByteArrayFromObj(ov[i], &len);
+		lens[i] = len;
+	}
 
-	state = (md5_state_t*)Tcl_GetByteArrayFromObj(objv[1], &dontcare);
+	switch (variant) {
+		case 256: SHA256_Batch(count, data, lens, (uint8_t(*)[SHA256_DIGEST_LENGTH])digests); break;
+		case 384: SHA384_Batch(count, data, lens, (uint8_t(*)[SHA384_DIGEST_LENGTH])digests); break;
+		case 512: SHA512_Batch(count, data, lens, (uint8_t(*)[SHA512_DIGEST_LENGTH])digests); break;
+	}
 
-	md5_finish(state, digest);
+	res = Tcl_NewListObj(count, NULL);
+	for (Tcl_Size i=0; i<count; i++)
+		Tcl_ListObjAppendElement(NULL, res, digest_obj(digests + i*digest_len, digest_len, format));
 
-	Tcl_SetObjResult(interp, Tcl_NewByteArrayObj(digest, 16));
+	Tcl_SetObjResult(interp, res);
 
-	return TCL_OK;
+finally:
+	if (data)		ckfree(data);
+	if (lens)		ckfree(lens);
+	if (digests)	ckfree(digests);
+	return code;
 }
 
 //>>>
-static OBJCMD(glue_sha2) //<<<
+static int sha2_one(Tcl_Interp* interp, int variant, Tcl_Obj*const parts[], const struct digest_opts* opts) //<<<
 {
-	(void)cdata;
-	int				variant;
-	unsigned char*	data;
-	Tcl_Size		datalen;
-	Tcl_Obj*		res = NULL;
+	int					code = TCL_OK;
+	Tcl_Size			datalen;
+	unsigned char*		data;
+	unsigned char		digest[SHA512_DIGEST_LENGTH];
+	size_t				digest_len;
+	enum hash_alg_id	alg;
 
-	CHECK_ARGS(2, "variant data");
+	switch (variant) {
+		case 256: digest_len = SHA256_DIGEST_LENGTH; alg = HASH_SHA256; break;
+		case 384: digest_len = SHA384_DIGEST_LENGTH; alg = HASH_SHA384; break;
+		case 512: digest_len = SHA512_DIGEST_LENGTH; alg = HASH_SHA512; break;
+		default:
+			THROW_PRINTF_LABEL(finally, code, "Unsupported SHA-2 variant: %d", variant);
+	}
 
-	TEST_OK(Tcl_GetIntFromObj(interp, objv[1], &variant));
-	data = Tcl_GetByteArrayFromObj(objv[2], &datalen);
+	if (opts->memo && memo_lookup(interp, parts[0], alg, opts->utf8, digest, digest_len))
+		goto done;
+
+	if (!DIGEST_PLAIN(opts)) {
+		TEST_OK_LABEL(finally, code, hash_parts(interp, alg, parts, opts, digest));
+		goto store;
+	}
 
+	data = Tcl_GetByteArrayFromObj(parts[0], &datalen);
 	switch (variant) {
 		case 256:
 			{
 				SHA256_CTX		ctx;
-				char			out[SHA256_DIGEST_STRING_LENGTH];
 
 				SHA256_Init(&ctx);
 				SHA256_Update(&ctx, data, datalen);
-				SHA256_End(&ctx, out);
-
-				res = Tcl_NewStringObj(out, -1);
+				SHA256_Final(digest, &ctx);
 			}
 			break;
 
 		case 384:
 			{
 				SHA384_CTX		ctx;
-				char			out[SHA384_DIGEST_STRING_LENGTH];
 
 				SHA384_Init(&ctx);
 				SHA384_Update(&ctx, data, datalen);
-				SHA384_End(&ctx, out);
-
-				res = Tcl_NewStringObj(out, -1);
+				SHA384_Final(digest, &ctx);
 			}
 			break;
 
 		case 512:
 			{
 				SHA512_CTX		ctx;
-				char			out[SHA512_DIGEST_STRING_LENGTH];
 
 				SHA512_Init(&ctx);
 				SHA512_Update(&ctx, data, datalen);
-				SHA512_End(&ctx, out);
-
-				res = Tcl_NewStringObj(out, -1);
+				SHA512_Final(digest, &ctx);
 			}
 			break;
+	}
 
-		default:
-			THROW_ERROR("Unsupported SHA-2 variant: ", Tcl_GetString(objv[1]));
-			break;
+store:
+	if (opts->memo) memo_store(interp, parts[0], alg, opts->utf8, digest, digest_len);
+
+done:
+	Tcl_SetObjResult(interp, digest_obj(digest, digest_len, opts->format));
+
+finally:
+	return code;
+}
+
+//>>>
+// Digests are returned as hex for historical reasons, unless another -format is given
+static OBJCMD(glue_sha2) //<<<
+{
+	(void)cdata;
+	struct digest_opts	opts = {.format = DIGEST_HEX};
+	int					argi, variant;
+
+	TEST_OK(digest_options(interp, objc, objv, 2, "?-batch? ?-binary? ?-encoding encoding? ?-format format? ?-length length? ?-memo? ?-offset offset? ?--? variant data ?data ...?", DIGEST_OPT_BATCH|DIGEST_OPT_BINARY|DIGEST_OPT_ENCODING|DIGEST_OPT_FORMAT|DIGEST_OPT_MEMO|DIGEST_OPT_PARTS|DIGEST_OPT_RANGE, &opts, &argi));
+	TEST_OK(Tcl_GetIntFromObj(interp, objv[argi], &variant));
+
+	return opts.batch ?
+		sha2_batch(interp, variant, objv[argi+1], opts.format) :
+		sha2_one(interp, variant, objv+argi+1, &opts);
+}
+
+//>>>
+// hash::sha256, hash::sha384 and hash::sha512, with the variant in cdata
+static OBJCMD(glue_sha2_variant) //<<<
+{
+	const int			variant = (int)(intptr_t)cdata;
+	struct digest_opts	opts = {.format = DIGEST_HEX};
+	int					argi;
+
+	TEST_OK(digest_options(interp, objc, objv, 1, "?-batch? ?-binary? ?-encoding encoding? ?-format format? ?-length length? ?-memo? ?-offset offset? ?--? data ?data ...?", DIGEST_OPT_BATCH|DIGEST_OPT_BINARY|DIGEST_OPT_ENCODING|DIGEST_OPT_FORMAT|DIGEST_OPT_MEMO|DIGEST_OPT_PARTS|DIGEST_OPT_RANGE, &opts, &argi));
+
+	return opts.batch ?
+		sha2_batch(interp, variant, objv[argi], opts.format) :
+		sha2_one(interp, variant, objv+argi, &opts);
+}
+
+//>>>
+#if TESTMODE
+static OBJCMD(sha2_impl_cmd) //<<<
+{
+	(void)cdata;
+	int			code = TCL_OK;
+
+	enum {A_cmd, A_IMPL, A_objc};
+	if (objc > A_objc) {
+		Tcl_WrongNumArgs(interp, A_cmd+1, objv, "?impl?");
+		code = TCL_ERROR;
+		goto finally;
 	}
 
+	if (objc > A_IMPL) {
+		const char*	name = Tcl_GetString(objv[A_IMPL]);
+		size_t		i;
+
+		if (strcmp(name, "auto") == 0) {
+			sha2_select(NULL);
+		} else {
+			for (i=0; i<sha2_impls_count; i++)
+				if (strcmp(name, sha2_impls[i]->name) == 0 && CPU_HAS(sha2_impls[i]->requires))
+					break;
+
+			if (i == sha2_impls_count)
+				THROW_ERROR_LABEL(finally, code, "sha2 implementation \"", name, "\" not available");
+
+			sha2_select(sha2_impls[i]);
+		}
+	}
+
+	Tcl_Obj*	res = Tcl_NewListObj(0, NULL);
+	for (int op=0; op<SHA2_OP_COUNT; op++) {
+		const struct sha2_impl*	impl = sha2_current(op);
+		Tcl_ListObjAppendElement(NULL, res, Tcl_NewStringObj(sha2_op_names[op], -1));
+		Tcl_ListObjAppendElement(NULL, res, Tcl_NewStringObj(impl ? impl->name : "", -1));
+	}
 	Tcl_SetObjResult(interp, res);
 
-	return TCL_OK;
+finally:
+	return code;
 }
 
 //>>>
-static OBJCMD(glue_sha256) //<<<
+static OBJCMD(sha2_impls_cmd) //<<<
 {
 	(void)cdata;
-	unsigned char*	data;
-	Tcl_Size		datalen;
-	SHA256_CTX		ctx;
-	char			out[SHA256_DIGEST_STRING_LENGTH];
-
-	CHECK_ARGS(1, "data");
+	int			code = TCL_OK;
 
-	data = Tcl_GetByteArrayFromObj(objv[1], &datalen);
+	enum {A_cmd, A_objc};
+	CHECK_ARGS_LABEL(finally, code, "");
 
-	SHA256_Init(&ctx);
-	SHA256_Update(&ctx, data, datalen);
-	SHA256_End(&ctx, out);
+	Tcl_Obj*	res = Tcl_NewListObj(0, NULL);
+	for (size_t i=0; i<sha2_impls_count; i++)
+		if (CPU_HAS(sha2_impls[i]->requires))
+			Tcl_ListObjAppendElement(NULL, res, Tcl_NewStringObj(sha2_impls[i]->name, -1));
 
-	Tcl_SetObjResult(interp, Tcl_NewStringObj(out, -1));
+	Tcl_SetObjResult(interp, res);
 
-	return TCL_OK;
+finally:
+	return code;
 }
 
 //>>>
-static OBJCMD(glue_sha384) //<<<
+static OBJCMD(md5_impl_cmd) //<<<
 {
 	(void)cdata;
-	unsigned char*	data;
-	Tcl_Size		datalen;
-	SHA384_CTX		ctx;
-	char			out[SHA384_DIGEST_STRING_LENGTH];
+	int			code = TCL_OK;
 
-	CHECK_ARGS(1, "data");
+	enum {A_cmd, A_IMPL, A_objc};
+	if (objc > A_objc) {
+		Tcl_WrongNumArgs(interp, A_cmd+1, objv, "?impl?");
+		code = TCL_ERROR;
+		goto finally;
+	}
 
-	data = Tcl_GetByteArrayFromObj(objv[1], &datalen);
+	if (objc > A_IMPL) {
+		const char*	name = Tcl_GetString(objv[A_IMPL]);
+		size_t		i;
 
-	SHA384_Init(&ctx);
-	SHA384_Update(&ctx, data, datalen);
-	SHA384_End(&ctx, out);
+		for (i=0; i<md5_impls_count; i++)
+			if (strcmp(name, md5_impls[i]->name) == 0 && CPU_HAS(md5_impls[i]->requires))
+				break;
 
-	Tcl_SetObjResult(interp, Tcl_NewStringObj(out, -1));
+		if (i == md5_impls_count)
+			THROW_ERROR_LABEL(finally, code, "md5 implementation \"", name, "\" not available");
 
-	return TCL_OK;
+		md5_select(md5_impls[i]);
+	}
+
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(md5_current()->name, -1));
+
+finally:
+	return code;
 }
 
 //>>>
-static OBJCMD(glue_sha512) //<<<
+static OBJCMD(md5_impls_cmd) //<<<
 {
 	(void)cdata;
-	unsigned char*	data;
-	Tcl_Size		datalen;
-	SHA512_CTX		ctx;
-	char			out[SHA512_DIGEST_STRING_LENGTH];
+	int			code = TCL_OK;
 
-	CHECK_ARGS(1, "data");
+	enum {A_cmd, A_objc};
+	CHECK_ARGS_LABEL(finally, code, "");
 
-	data = Tcl_GetByteArrayFromObj(objv[1], &datalen);
+	Tcl_Obj*	res = Tcl_NewListObj(0, NULL);
+	for (size_t i=0; i<md5_impls_count; i++)
+		if (CPU_HAS(md5_impls[i]->requires))
+			Tcl_ListObjAppendElement(NULL, res, Tcl_NewStringObj(md5_impls[i]->name, -1));
 
-	SHA512_Init(&ctx);
-	SHA512_Update(&ctx, data, datalen);
-	SHA512_End(&ctx, out);
+	Tcl_SetObjResult(interp, res);
 
-	Tcl_SetObjResult(interp, Tcl_NewStringObj(out, -1));
+finally:
+	return code;
+}
 
-	return TCL_OK;
+//>>>
+static OBJCMD(encode_impl_cmd) //<<<
+{
+	(void)cdata;
+	int			code = TCL_OK;
+
+	enum {A_cmd, A_IMPL, A_objc};
+	if (objc > A_objc) {
+		Tcl_WrongNumArgs(interp, A_cmd+1, objv, "?impl?");
+		code = TCL_ERROR;
+		goto finally;
+	}
+
+	if (objc > A_IMPL) {
+		const char*	name = Tcl_GetString(objv[A_IMPL]);
+		size_t		i;
+
+		if (strcmp(name, "auto") == 0) {
+			encode_select(NULL);
+		} else {
+			for (i=0; i<encode_impls_count; i++)
+				if (strcmp(name, encode_impls[i]->name) == 0 && CPU_HAS(encode_impls[i]->requires))
+					break;
+
+			if (i == encode_impls_count)
+				THROW_ERROR_LABEL(finally, code, "encode implementation \"", name, "\" not available");
+
+			encode_select(encode_impls[i]);
+		}
+	}
+
+	Tcl_Obj*	res = Tcl_NewListObj(0, NULL);
+	for (int op=0; op<ENCODE_OP_COUNT; op++) {
+		Tcl_ListObjAppendElement(NULL, res, Tcl_NewStringObj(encode_op_names[op], -1));
+		Tcl_ListObjAppendElement(NULL, res, Tcl_NewStringObj(encode_current(op)->name, -1));
+	}
+	Tcl_SetObjResult(interp, res);
+
+finally:
+	return code;
+}
+
+//>>>
+static OBJCMD(encode_impls_cmd) //<<<
+{
+	(void)cdata;
+	int			code = TCL_OK;
+
+	enum {A_cmd, A_objc};
+	CHECK_ARGS_LABEL(finally, code, "");
+
+	Tcl_Obj*	res = Tcl_NewListObj(0, NULL);
+	for (size_t i=0; i<encode_impls_count; i++)
+		if (CPU_HAS(encode_impls[i]->requires))
+			Tcl_ListObjAppendElement(NULL, res, Tcl_NewStringObj(encode_impls[i]->name, -1));
+
+	Tcl_SetObjResult(interp, res);
+
+finally:
+	return code;
 }
 
 //>>>
+#endif
 int Hash_Init(Tcl_Interp* interp) //<<<
 {
 	int		code = TCL_OK;
@@ -219,23 +417,60 @@ int Hash_Init(Tcl_Interp* interp) //<<<
 	if (Tcl_InitStubs(interp, TCL_VERSION, 0) == NULL) return TCL_ERROR;
 #endif
 
+	cpu_detect();
+	md5_select(NULL);
+	sha2_select(NULL);
+	encode_select(NULL);
+
 	Tcl_Namespace*	ns = Tcl_CreateNamespace(interp, NS, NULL, NULL);
 	TEST_OK_LABEL(finally, code, Tcl_Export(interp, ns, "*", 0));
 
 	// MD5
 	Tcl_CreateObjCommand(interp, NS "::md5", glue_md5, NULL, NULL);
-	Tcl_CreateObjCommand(interp, NS "::md5_init", glue_md5_init, NULL, NULL);
-	Tcl_CreateObjCommand(interp, NS "::md5_append", glue_md5_append, NULL, NULL);
-	Tcl_CreateObjCommand(interp, NS "::md5_finish", glue_md5_finish, NULL, NULL);
+#if TESTMODE
+	Tcl_CreateObjCommand(interp, NS "::_testmode_md5_impl", md5_impl_cmd, NULL, NULL);
+	Tcl_CreateObjCommand(interp, NS "::_testmode_md5_impls", md5_impls_cmd, NULL, NULL);
+#endif
 
 	// SHA-2
 	Tcl_CreateObjCommand(interp, NS "::sha2", glue_sha2, NULL, NULL);
-	Tcl_CreateObjCommand(interp, NS "::sha256", glue_sha256, NULL, NULL);
-	Tcl_CreateObjCommand(interp, NS "::sha384", glue_sha384, NULL, NULL);
-	Tcl_CreateObjCommand(interp, NS "::sha512", glue_sha512, NULL, NULL);
+	Tcl_CreateObjCommand(interp, NS "::sha256", glue_sha2_variant, (ClientData)(intptr_t)256, NULL);
+	Tcl_CreateObjCommand(interp, NS "::sha384", glue_sha2_variant, (ClientData)(intptr_t)384, NULL);
+	Tcl_CreateObjCommand(interp, NS "::sha512", glue_sha2_variant, (ClientData)(intptr_t)512, NULL);
+#if TESTMODE
+	Tcl_CreateObjCommand(interp, NS "::_testmode_sha2_impl", sha2_impl_cmd, NULL, NULL);
+	Tcl_CreateObjCommand(interp, NS "::_testmode_sha2_impls", sha2_impls_cmd, NULL, NULL);
+#endif
+
+	// Text encodings of the digests, for -format
+#if TESTMODE
+	Tcl_CreateObjCommand(interp, NS "::_testmode_encode_impl", encode_impl_cmd, NULL, NULL);
+	Tcl_CreateObjCommand(interp, NS "::_testmode_encode_impls", encode_impls_cmd, NULL, NULL);
+#endif
 
 	TEST_OK_LABEL(finally, code, areion_init(interp));
 
+	// Streaming contexts for all of the above, including md5_init and areion512_md_init
+	TEST_OK_LABEL(finally, code, context_init(interp));
+
+	// Lists of messages for any of the above in one call
+	TEST_OK_LABEL(finally, code, batch_init(interp));
+
+	// The -memo digest cache
+	TEST_OK_LABEL(finally, code, memo_init(interp));
+
+	// Whatever can be read from a channel, a chunk at a time
+	TEST_OK_LABEL(finally, code, channel_init(interp));
+
+	// Channel transforms that hash what passes through them
+	TEST_OK_LABEL(finally, code, tap_init(interp));
+
+	// Local files, mapped where they can be
+	TEST_OK_LABEL(finally, code, file_init(interp));
+
+	// Many files at once, with io_uring where there is one
+	TEST_OK_LABEL(finally, code, paths_init(interp));
+
 	TEST_OK_LABEL(finally, code, Tcl_PkgProvide(interp, PACKAGE_NAME, PACKAGE_VERSION));
 
 finally:
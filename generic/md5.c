@@ -37,6 +37,10 @@
   <ghost@aladdin.com>.  Other authors are noted in the change history
   that follows (in reverse chronological order):
 
+  2026-10-18 md5_append takes a size_t length, so messages of 2GB and
+	more are safe.
+  2026-10-17 Added md5_batch, which hashes independent messages through
+	a runtime selected multi-buffer engine (see md5_impl.h).
   2002-04-13 lpd Clarified derivation from RFC 1321; now handles byte order
 	either statically or dynamically; added missing #include <string.h>
 	in library.
@@ -52,6 +56,11 @@
  */
 
 #include "md5.h"
+#include "md5_impl.h"
+#include "cpu.h"
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
 #include <string.h>
 
 #undef BYTE_ORDER	/* 1 = big-endian, -1 = little-endian, 0 = unknown */
@@ -320,25 +329,25 @@ md5_init(md5_state_t *pms)
 }
 
 void
-md5_append(md5_state_t *pms, const md5_byte_t *data, int nbytes)
+md5_append(md5_state_t *pms, const md5_byte_t *data, size_t nbytes)
 {
     const md5_byte_t *p = data;
-    int left = nbytes;
-    int offset = (pms->count[0] >> 3) & 63;
+    size_t left = nbytes;
+    size_t offset = (pms->count[0] >> 3) & 63;
     md5_word_t nbits = (md5_word_t)(nbytes << 3);
 
-    if (nbytes <= 0)
+    if (nbytes == 0)
 	return;
 
     /* Update the message length. */
-    pms->count[1] += nbytes >> 29;
+    pms->count[1] += (md5_word_t)(nbytes >> 29);
     pms->count[0] += nbits;
     if (pms->count[0] < nbits)
 	pms->count[1]++;
 
     /* Process an initial partial block. */
     if (offset) {
-	int copy = (offset + nbytes > 64 ? 64 - offset : nbytes);
+	size_t copy = (offset + nbytes > 64 ? 64 - offset : nbytes);
 
 	memcpy(pms->buf + offset, p, copy);
 	if (offset + copy < 64)
@@ -379,3 +388,201 @@ md5_finish(md5_state_t *pms, md5_byte_t digest[16])
     for (i = 0; i < 16; ++i)
 	digest[i] = (md5_byte_t)(pms->abcd[i >> 2] >> ((i & 3) << 3));
 }
+
+/*
+ * Multi-buffer engine selection.
+ */
+
+const struct md5_impl md5_impl_portable = {
+    "portable", 0, NULL
+};
+
+const struct md5_impl *const md5_impls[] = {
+#if HAVE_AVX2
+    &md5_impl_avx2,
+#endif
+    &md5_impl_portable
+};
+const size_t md5_impls_count = sizeof(md5_impls) / sizeof(md5_impls[0]);
+
+static const struct md5_impl *md5_installed = &md5_impl_portable;
+
+void
+md5_select(const struct md5_impl *impl)
+{
+    size_t i;
+
+    if (impl == NULL) {
+	for (i = 0; i < md5_impls_count; ++i)
+	    if (CPU_HAS(md5_impls[i]->requires))
+		break;
+	impl = md5_impls[i < md5_impls_count ? i : md5_impls_count - 1];
+    }
+    md5_installed = impl;
+}
+
+const struct md5_impl *
+md5_current(void)
+{
+    return md5_installed;
+}
+
+/*
+ * Hash count independent messages, a lane of the multi-buffer engine per
+ * message.  Each lane is an md5_state_t, whose abcd is transposed into
+ * the engine's state while the lane is busy, plus the lane's padded final
+ * block(s).  A lane runs through its message's complete blocks straight from the
+ * caller's data, then the final block(s), and is refilled with the next
+ * waiting message as soon as it finishes.  Once too few lanes are busy to
+ * be worth it the stragglers finish one at a time.
+ */
+
+typedef struct md5_lane_s {
+    md5_state_t state;
+    md5_byte_t tail[128];	/* padded final block(s) */
+    int busy;
+    size_t msg;			/* index of the message in this lane */
+    const md5_byte_t *p;	/* next block of the current segment */
+    size_t left;		/* blocks left in the current segment */
+    int in_tail;		/* the current segment is the final block(s) */
+    size_t tail_blocks;
+} md5_lane_t;
+
+static void
+md5_lane_start(md5_lane_t *lane, size_t msg, const md5_byte_t *data, size_t len)
+{
+    size_t full = len / 64, rem = len % 64;
+    md5_byte_t *tail = lane->tail;
+    int i;
+
+    md5_init(&lane->state);
+    lane->state.count[0] = (md5_word_t)(len << 3);
+    lane->state.count[1] = (md5_word_t)((unsigned long long)len >> 29);
+
+    /* Build the padded final block(s). */
+    lane->tail_blocks = rem + 1 + 8 > 64 ? 2 : 1;
+    memcpy(tail, data + full * 64, rem);
+    tail[rem] = 0x80;
+    memset(tail + rem + 1, 0, lane->tail_blocks * 64 - rem - 1);
+    for (i = 0; i < 8; ++i)
+	tail[lane->tail_blocks * 64 - 8 + i] =
+	    (md5_byte_t)(lane->state.count[i >> 2] >> ((i & 3) << 3));
+
+    lane->busy = 1;
+    lane->msg = msg;
+    if (full) {
+	lane->p = data;
+	lane->left = full;
+	lane->in_tail = 0;
+    } else {
+	lane->p = tail;
+	lane->left = lane->tail_blocks;
+	lane->in_tail = 1;
+    }
+}
+
+/* Move the lane on by n blocks, return 1 when its message is done. */
+static int
+md5_lane_advance(md5_lane_t *lane, size_t n)
+{
+    lane->p += n * 64;
+    lane->left -= n;
+    if (lane->left)
+	return 0;
+    if (lane->in_tail) {
+	lane->busy = 0;
+	return 1;
+    }
+    lane->p = lane->tail;
+    lane->left = lane->tail_blocks;
+    lane->in_tail = 1;
+    return 0;
+}
+
+static void
+md5_lane_digest(md5_word_t abcd[4][8], int l, md5_byte_t digest[16])
+{
+    int i;
+
+    for (i = 0; i < 16; ++i)
+	digest[i] = (md5_byte_t)(abcd[i >> 2][l] >> ((i & 3) << 3));
+}
+
+void
+md5_batch(size_t count, const md5_byte_t *const data[], const size_t len[],
+	  md5_byte_t digest[][16])
+{
+    const struct md5_impl *impl = md5_installed;
+    md5_lane_t lane[8];
+    md5_word_t abcd[4][8];
+    const md5_byte_t *ptr[8], *spare;
+    size_t next = 0, n, i;
+    int l, j, active;
+
+    if (impl->x8 == NULL) {
+	md5_state_t state;
+
+	for (i = 0; i < count; ++i) {
+	    md5_init(&state);
+	    md5_append(&state, data[i], len[i]);
+	    md5_finish(&state, digest[i]);
+	}
+	return;
+    }
+
+    memset(lane, 0, sizeof(lane));
+    memset(abcd, 0, sizeof(abcd));
+    for (;;) {
+	/* Refill idle lanes. */
+	for (l = 0; l < 8 && next < count; ++l) {
+	    if (lane[l].busy)
+		continue;
+	    md5_lane_start(&lane[l], next, data[next], len[next]);
+	    for (j = 0; j < 4; ++j)
+		abcd[j][l] = lane[l].state.abcd[j];
+	    ++next;
+	}
+
+	/* Step by the shortest segment, idle lanes shadow a busy one. */
+	active = 0;
+	n = 0;
+	spare = NULL;
+	for (l = 0; l < 8; ++l) {
+	    if (!lane[l].busy)
+		continue;
+	    ++active;
+	    spare = lane[l].p;
+	    if (n == 0 || lane[l].left < n)
+		n = lane[l].left;
+	}
+	if (active == 0)
+	    break;
+	for (l = 0; l < 8; ++l)
+	    ptr[l] = lane[l].busy ? lane[l].p : spare;
+
+	if (next == count && active * 4 <= 8) {
+	    /* Nothing left to refill with, finish the stragglers one by one. */
+	    for (l = 0; l < 8; ++l) {
+		if (!lane[l].busy)
+		    continue;
+		for (j = 0; j < 4; ++j)
+		    lane[l].state.abcd[j] = abcd[j][l];
+		while (lane[l].busy) {
+		    for (i = 0; i < lane[l].left; ++i)
+			md5_process(&lane[l].state, lane[l].p + i * 64);
+		    md5_lane_advance(&lane[l], lane[l].left);
+		}
+		for (j = 0; j < 4; ++j)
+		    abcd[j][l] = lane[l].state.abcd[j];
+		md5_lane_digest(abcd, l, digest[lane[l].msg]);
+	    }
+	    break;
+	}
+
+	impl->x8(abcd, ptr, n);
+
+	for (l = 0; l < 8; ++l)
+	    if (lane[l].busy && md5_lane_advance(&lane[l], n))
+		md5_lane_digest(abcd, l, digest[lane[l].msg]);
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef _HASH_MD5_IMPL_H
+#define _HASH_MD5_IMPL_H
+
+#include <stddef.h>
+
+#include "md5.h"
+
+/*
+ * Multi-buffer MD5 engines behind md5_batch.  Like the SHA-2 kernels, each
+ * lives in its own translation unit compiled with the ISA flags it needs,
+ * and md5.c installs the best one the host CPU supports at init time.
+ *
+ * x8 compresses nblocks consecutive 64 byte blocks of 8 independent messages
+ * into their chaining values, kept transposed (abcd[word][lane]), with
+ * data[lane] pointing at that lane's blocks.  The portable implementation
+ * has none: md5_batch then just hashes the messages one at a time.
+ */
+struct md5_impl {
+	const char*		name;
+	unsigned int	requires;		// Mask of enum cpu_feature bits this implementation needs
+
+	void (*x8)(md5_word_t abcd[4][8], const md5_byte_t* const data[8], size_t nblocks);
+};
+
+extern const struct md5_impl	md5_impl_avx2;
+extern const struct md5_impl	md5_impl_portable;
+
+extern const struct md5_impl* const	md5_impls[];	// In order of preference, portable last
+extern const size_t						md5_impls_count;
+
+/*
+ * Install impl, or with impl == NULL the best the host CPU supports.  Call
+ * after cpu_detect().
+ */
+void md5_select(const struct md5_impl* impl);
+
+const struct md5_impl* md5_current(void);
+
+#endif
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
@@ -0,0 +1,164 @@
+#include "hashInt.h"
+#include <string.h>
+
+/*
+ * Opt-in digest memoisation, for the -memo option of the one shot digest
+ * commands.  Each interp keeps a small table of the values it has been
+ * asked to memoise, with the digests computed so far for each.  The table
+ * holds a reference to every value in it, so the pointer can't be reused
+ * for a different value while the entry exists, and since a shared Tcl_Obj
+ * is copied rather than changed, any change to a variable holding the
+ * value gives it a new Tcl_Obj, which misses.  The one exception is
+ * hash::md5_append, which changes its (shared) handle in place, as it
+ * always has: it calls memo_forget to drop whatever was memoised for it.
+ *
+ * The cost is that memoised values are kept alive until their entry is
+ * reused, so the table is small and entries whose only reference is ours
+ * are reused first.  hash::memo_clear releases them all.
+ */
+
+#define MEMO_ENTRIES	32
+
+struct memo_entry {
+	Tcl_Obj*		obj;						// NULL if unused
+	unsigned int	have;						// Bitmask of 1 << memo_slot()
+	uint8_t			digest[2*HASH_ALG_COUNT][64];
+};
+
+struct memo_cache {
+	size_t				next;					// Round robin victim when every entry is live
+	struct memo_entry	entries[MEMO_ENTRIES];
+};
+
+// Digests of the bytes and of the string rep (-encoding utf-8) differ, so each gets its own slot
+static inline int memo_slot(enum hash_alg_id alg, int utf8) //<<<
+{
+	return utf8 ? HASH_ALG_COUNT + alg : alg;
+}
+
+//>>>
+static void memo_clear(struct memo_cache* cache) //<<<
+{
+	for (size_t i=0; i<MEMO_ENTRIES; i++) {
+		release_tclobj(&cache->entries[i].obj);
+		cache->entries[i].have = 0;
+	}
+}
+
+//>>>
+static void free_memo_cache(ClientData cdata, Tcl_Interp* interp) //<<<
+{
+	(void)interp;
+	struct memo_cache*	cache = cdata;
+
+	memo_clear(cache);
+	ckfree(cache);
+}
+
+//>>>
+static struct memo_cache* get_memo_cache(Tcl_Interp* interp, int create) //<<<
+{
+	struct memo_cache*	cache = Tcl_GetAssocData(interp, "hash::memo", NULL);
+
+	if (cache == NULL && create) {
+		cache = ckalloc(sizeof(*cache));
+		memset(cache, 0, sizeof(*cache));
+		Tcl_SetAssocData(interp, "hash::memo", free_memo_cache, cache);
+	}
+
+	return cache;
+}
+
+//>>>
+int memo_lookup(Tcl_Interp* interp, Tcl_Obj* data, enum hash_alg_id alg, int utf8, uint8_t* digest, size_t len) //<<<
+{
+	struct memo_cache*	cache = get_memo_cache(interp, 0);
+	const int			slot = memo_slot(alg, utf8);
+
+	if (cache == NULL) return 0;
+
+	for (size_t i=0; i<MEMO_ENTRIES; i++) {
+		const struct memo_entry*	e = &cache->entries[i];
+
+		if (e->obj == data) {
+			if (!(e->have & 1u << slot)) return 0;
+			memcpy(digest, e->digest[slot], len);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+//>>>
+void memo_store(Tcl_Interp* interp, Tcl_Obj* data, enum hash_alg_id alg, int utf8, const uint8_t* digest, size_t len) //<<<
+{
+	struct memo_cache*	cache = get_memo_cache(interp, 1);
+	const int			slot = memo_slot(alg, utf8);
+	struct memo_entry*	e = NULL;
+
+	for (size_t i=0; i<MEMO_ENTRIES && !e; i++)
+		if (cache->entries[i].obj == data)
+			e = &cache->entries[i];
+
+	// Otherwise an unused entry, or one whose value nothing else refers to any more
+	for (size_t i=0; i<MEMO_ENTRIES && !e; i++)
+		if (cache->entries[i].obj == NULL || cache->entries[i].obj->refCount == 1)
+			e = &cache->entries[i];
+
+	if (e == NULL) {
+		e = &cache->entries[cache->next];
+		cache->next = (cache->next + 1) % MEMO_ENTRIES;
+	}
+
+	if (e->obj != data) {
+		replace_tclobj(&e->obj, data);
+		e->have = 0;
+	}
+	memcpy(e->digest[slot], digest, len);
+	e->have |= 1u << slot;
+}
+
+//>>>
+void memo_forget(Tcl_Interp* interp, Tcl_Obj* data) //<<<
+{
+	struct memo_cache*	cache = get_memo_cache(interp, 0);
+
+	if (cache == NULL) return;
+
+	for (size_t i=0; i<MEMO_ENTRIES; i++) {
+		if (cache->entries[i].obj == data) {
+			release_tclobj(&cache->entries[i].obj);
+			cache->entries[i].have = 0;
+		}
+	}
+}
+
+//>>>
+static OBJCMD(memo_clear_cmd) //<<<
+{
+	(void)cdata;
+	int					code = TCL_OK;
+	struct memo_cache*	cache = get_memo_cache(interp, 0);
+
+	enum {A_cmd, A_objc};
+	CHECK_ARGS_LABEL(finally, code, "");
+
+	if (cache) memo_clear(cache);
+
+finally:
+	return code;
+}
+
+//>>>
+
+int memo_init(Tcl_Interp* interp) //<<<
+{
+	Tcl_CreateObjCommand(interp, NS "::memo_clear", memo_clear_cmd, NULL, NULL);
+
+	return TCL_OK;
+}
+
+//>>>
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
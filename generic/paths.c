@@ -0,0 +1,658 @@
+#include "hashInt.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#if HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+/*
+ * hash::paths: hash many files in one go, for checking a build cache and
+ * the like, where there are thousands of them, mostly small, and the time
+ * goes on waiting for each read rather than on hashing.  With io_uring the
+ * reads for many files (and several ahead in each large one) are kept in
+ * flight on one ring, and each buffer that completes is hashed into its
+ * file's context on this thread, in order.  Where there's no io_uring (in
+ * the headers, the kernel, or a sandbox that forbids it) a pool of threads
+ * each hash a file at a time with pread.  -direct opens the files with
+ * O_DIRECT where the filesystem allows it (see file_open), so that hashing
+ * them doesn't push everything else out of the page cache: the buffers,
+ * offsets and lengths read are all multiples of PATHS_ALIGN for it.
+ */
+
+#define PATHS_DEPTH		64				// Reads in flight on the ring
+#define PATHS_CHUNK		(128 << 10)		// Bytes per read
+#define PATHS_ALIGN		4096			// At least the block size O_DIRECT needs
+#define PATHS_THREADS	16				// In the pread pool, at most
+
+enum paths_engine {PATHS_AUTO, PATHS_IO_URING, PATHS_PREAD};
+static const char* const	paths_engine_names[] = {"auto", "io_uring", "pread", NULL};
+static enum paths_engine	paths_engine = PATHS_AUTO;		// Only not auto in testmode, to reach the fallback
+
+struct path_job {
+	const char*			native;
+	int					fd;
+	int					err;			// errno of whatever failed, else 0
+	const char*			what;			// What failed with err: "couldn't open" or "error reading"
+	int					sized;			// A regular file that says how long it is, so its reads can be issued ahead
+	uint64_t			size;
+	uint64_t			pos;			// Bytes asked for so far (with io_uring) or hashed (with pread)
+	struct hash_ctx*	ctx;
+	uint8_t				digest[64];
+	size_t				digest_len;
+#if HAVE_IO_URING
+	int					inflight;		// Reads on the ring
+	int					head, tail;		// Those reads in order, linked through ring_slot.next, -1 if none
+	int					eof;			// Nothing more will be asked for
+#endif
+};
+
+struct paths {
+	enum hash_alg_id	alg;
+	int					direct;
+	int					count;
+	struct path_job*	jobs;
+	int					next;			// The next job for the pread pool to take
+	Tcl_Mutex			mutex;			// Guards next
+};
+
+static uint8_t* aligned(void* mem) //<<<
+{
+	return (uint8_t*)(((uintptr_t)mem + PATHS_ALIGN-1) & ~(uintptr_t)(PATHS_ALIGN-1));
+}
+
+//>>>
+static void job_open(struct paths* p, struct path_job* j) //<<<
+{
+	j->fd = file_open(j->native, p->direct, &j->size);
+	if (j->fd == -1) {
+		j->err  = errno;
+		j->what = "couldn't open";
+		return;
+	}
+
+	j->sized = j->size > 0;
+	j->ctx   = hash_begin(p->alg);
+}
+
+//>>>
+static void job_close(struct path_job* j) //<<<
+{
+	if (j->ctx) {
+		if (j->err)	hash_end(j->ctx, NULL);
+		else		j->digest_len = hash_end(j->ctx, j->digest);
+		j->ctx = NULL;
+	}
+	if (j->fd != -1) {
+		close(j->fd);
+		j->fd = -1;
+	}
+}
+
+//>>>
+// The pread pool <<<
+static void pool_hash(struct paths* p, struct path_job* j, uint8_t* buf) //<<<
+{
+	job_open(p, j);
+
+	while (!j->err && !(j->sized && j->pos == j->size)) {
+		// Pipes and the like can't pread, but then they're only read from the start
+		const ssize_t	got = j->sized ? pread(j->fd, buf, PATHS_CHUNK, j->pos) : read(j->fd, buf, PATHS_CHUNK);
+
+		if (got == -1 && errno == EINTR) continue;
+		if (got == -1) {
+			j->err  = errno;
+			j->what = "error reading";
+			break;
+		}
+		if (got == 0) break;
+		hash_update(j->ctx, buf, got);
+		j->pos += got;
+	}
+
+	job_close(j);
+}
+
+//>>>
+static void pool_work(struct paths* p) //<<<
+{
+	void*		mem = ckalloc(PATHS_CHUNK + PATHS_ALIGN);
+	uint8_t*	buf = aligned(mem);
+
+	for (;;) {
+		Tcl_MutexLock(&p->mutex);
+		const int	i = p->next++;
+		Tcl_MutexUnlock(&p->mutex);
+
+		if (i >= p->count) break;
+		pool_hash(p, &p->jobs[i], buf);
+	}
+
+	ckfree(mem);
+}
+
+//>>>
+#if TCL_THREADS
+static Tcl_ThreadCreateType pool_thread(ClientData cdata) //<<<
+{
+	pool_work(cdata);
+	TCL_THREAD_CREATE_RETURN;
+}
+
+//>>>
+#endif
+static void pool_run(struct paths* p) //<<<
+{
+#if TCL_THREADS
+	// Reads block, so there are more threads than it takes to keep the cores busy hashing
+	Tcl_ThreadId	threads[PATHS_THREADS-1];
+	int				started = 0;
+	const int		want = (p->count < PATHS_THREADS ? p->count : PATHS_THREADS) - 1;
+
+	// If there are no threads to be had this one does all the work
+	while (started < want && Tcl_CreateThread(&threads[started], pool_thread, p, TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE) == TCL_OK)
+		started++;
+	pool_work(p);
+
+	for (int i=0; i<started; i++) {
+		int		result;
+		Tcl_JoinThread(threads[i], &result);
+	}
+#else
+	pool_work(p);
+#endif
+	Tcl_MutexFinalize(&p->mutex);
+}
+
+//>>>
+//>>>
+#if HAVE_IO_URING
+// The io_uring engine, on the raw syscalls so as not to need liburing <<<
+struct ring {
+	int						fd;
+	unsigned*				sq_tail;
+	unsigned*				sq_mask;
+	unsigned*				sq_array;
+	unsigned*				cq_head;
+	unsigned*				cq_tail;
+	unsigned*				cq_mask;
+	struct io_uring_sqe*	sqes;
+	struct io_uring_cqe*	cqes;
+	void*					sq_map;
+	size_t					sq_map_len;
+	void*					cq_map;
+	size_t					cq_map_len;
+	size_t					sqes_len;
+	unsigned				to_submit;		// Queued but not yet handed to the kernel
+	int						inflight;		// Handed over but not yet completed
+};
+
+struct ring_slot {
+	int				job;			// Index of the job it's reading for, -1 when free
+	int				next;			// The job's next read, or the next free slot
+	uint64_t		offset;
+	size_t			want;			// Bytes it should get, fewer at the end of a file
+	size_t			got;
+	int				done;
+	struct iovec	iov;
+	uint8_t*		buf;
+};
+
+static void ring_close(struct ring* r) //<<<
+{
+	if (r->sqes)								munmap(r->sqes, r->sqes_len);
+	if (r->cq_map && r->cq_map != r->sq_map)	munmap(r->cq_map, r->cq_map_len);
+	if (r->sq_map)								munmap(r->sq_map, r->sq_map_len);
+	if (r->fd != -1)							close(r->fd);
+	memset(r, 0, sizeof(*r));
+	r->fd = -1;
+}
+
+//>>>
+// 0 with the ring ready, else -1 and errno
+static int ring_open(struct ring* r, unsigned entries) //<<<
+{
+	struct io_uring_params	params;
+	int						err;
+
+	memset(r, 0, sizeof(*r));
+	memset(&params, 0, sizeof(params));
+
+	r->fd = syscall(__NR_io_uring_setup, entries, &params);
+	if (r->fd == -1) return -1;
+
+	r->sq_map_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	r->cq_map_len = params.cq_off.cqes  + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (r->cq_map_len > r->sq_map_len) r->sq_map_len = r->cq_map_len;
+		r->cq_map_len = r->sq_map_len;
+	}
+
+	r->sq_map = mmap(NULL, r->sq_map_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	if (r->sq_map == MAP_FAILED) {r->sq_map = NULL; goto failed;}
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		r->cq_map = r->sq_map;
+	} else {
+		r->cq_map = mmap(NULL, r->cq_map_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+		if (r->cq_map == MAP_FAILED) {r->cq_map = NULL; goto failed;}
+	}
+
+	r->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+	r->sqes     = mmap(NULL, r->sqes_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (r->sqes == MAP_FAILED) {r->sqes = NULL; goto failed;}
+
+	r->sq_tail  = (unsigned*)((char*)r->sq_map + params.sq_off.tail);
+	r->sq_mask  = (unsigned*)((char*)r->sq_map + params.sq_off.ring_mask);
+	r->sq_array = (unsigned*)((char*)r->sq_map + params.sq_off.array);
+	r->cq_head  = (unsigned*)((char*)r->cq_map + params.cq_off.head);
+	r->cq_tail  = (unsigned*)((char*)r->cq_map + params.cq_off.tail);
+	r->cq_mask  = (unsigned*)((char*)r->cq_map + params.cq_off.ring_mask);
+	r->cqes     = (struct io_uring_cqe*)((char*)r->cq_map + params.cq_off.cqes);
+
+	return 0;
+
+failed:
+	err = errno;
+	ring_close(r);
+	errno = err;
+	return -1;
+}
+
+//>>>
+// Queue a read of what the slot still wants, to be handed over by the next ring_enter
+static void ring_read(struct ring* r, struct ring_slot* slots, int s, int fd, int direct) //<<<
+{
+	struct ring_slot*		slot = &slots[s];
+	const unsigned			tail = *r->sq_tail;		// Only ever written here
+	const unsigned			i    = tail & *r->sq_mask;
+	struct io_uring_sqe*	sqe  = &r->sqes[i];
+	size_t					len  = slot->want - slot->got;
+
+	// O_DIRECT reads whole blocks, and just comes up short at the end of the file
+	if (direct) len = (len + PATHS_ALIGN-1) & ~(size_t)(PATHS_ALIGN-1);
+
+	slot->iov = (struct iovec){.iov_base = slot->buf + slot->got, .iov_len = len};
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode    = IORING_OP_READV;		// Rather than IORING_OP_READ, which needs 5.6
+	sqe->fd        = fd;
+	sqe->addr      = (uintptr_t)&slot->iov;
+	sqe->len       = 1;
+	sqe->off       = slot->offset + slot->got;
+	sqe->user_data = s;
+
+	r->sq_array[i] = i;
+	__atomic_store_n(r->sq_tail, tail+1, __ATOMIC_RELEASE);
+	r->to_submit++;
+	r->inflight++;
+}
+
+//>>>
+// Start a read for job, in a free slot, after those it already has
+static void ring_issue(struct paths* p, struct ring* r, struct ring_slot* slots, int* free, int job) //<<<
+{
+	struct path_job*	j = &p->jobs[job];
+	const int			s = *free;
+	struct ring_slot*	slot = &slots[s];
+
+	*free = slot->next;
+
+	slot->job    = job;
+	slot->next   = -1;
+	slot->offset = j->pos;
+	slot->want   = j->sized && j->size - j->pos < PATHS_CHUNK ? j->size - j->pos : PATHS_CHUNK;
+	slot->got    = 0;
+	slot->done   = 0;
+
+	if (j->tail == -1)	j->head = s;
+	else				slots[j->tail].next = s;
+	j->tail = s;
+	j->inflight++;
+
+	// Unsized files have one read at a time, and move on by what it got
+	if (j->sized) {
+		j->pos += slot->want;
+		if (j->pos == j->size) j->eof = 1;
+	}
+
+	ring_read(r, slots, s, j->fd, p->direct);
+}
+
+//>>>
+static void ring_complete(struct paths* p, struct ring* r, struct ring_slot* slots, int* free, int s, int res) //<<<
+{
+	struct ring_slot*	slot = &slots[s];
+	const int			job  = slot->job;
+	struct path_job*	j    = &p->jobs[job];
+
+	r->inflight--;
+
+	if (res == -EINTR || res == -EAGAIN) {
+		ring_read(r, slots, s, j->fd, p->direct);
+		return;
+	}
+
+	if (res < 0) {
+		if (!j->err) {
+			j->err  = -res;
+			j->what = "error reading";
+		}
+		j->eof = 1;
+	} else if (res == 0) {
+		// The end, or a file that shrank, which is hashed as it is now
+		j->eof = 1;
+	} else {
+		slot->got += res;
+		if (slot->got > slot->want) slot->got = slot->want;		// O_DIRECT's rounding up, if the file grew
+		if (j->sized && slot->got < slot->want) {
+			ring_read(r, slots, s, j->fd, p->direct);		// A short read, the rest is still to come
+			return;
+		}
+		if (!j->sized) j->pos += slot->got;
+	}
+	slot->done = 1;
+
+	// Hash what's done at the front of the job, in order
+	while (j->head != -1 && slots[j->head].done) {
+		const int			h  = j->head;
+		struct ring_slot*	hs = &slots[h];
+
+		if (!j->err) hash_update(j->ctx, hs->buf, hs->got);
+
+		j->head = hs->next;
+		if (j->head == -1) j->tail = -1;
+		j->inflight--;
+
+		hs->job  = -1;
+		hs->next = *free;
+		*free    = h;
+	}
+
+	if (!j->sized && !j->eof) {
+		ring_issue(p, r, slots, free, job);
+	} else if (j->eof && j->inflight == 0) {
+		job_close(j);
+	}
+}
+
+//>>>
+// Hand over what's queued, and wait for at least one completion if anything is in flight
+static int ring_enter(struct ring* r) //<<<
+{
+	for (;;) {
+		const int	got = syscall(__NR_io_uring_enter, r->fd, r->to_submit, r->inflight ? 1 : 0, IORING_ENTER_GETEVENTS, NULL, 0);
+
+		if (got == -1 && errno == EINTR) continue;
+		if (got == -1) return -1;
+		r->to_submit -= got;
+		return 0;
+	}
+}
+
+//>>>
+// 0 when done, 1 if there's no io_uring to be had, else -1 and errno
+static int ring_run(struct paths* p) //<<<
+{
+	struct ring			r;
+	struct ring_slot	slots[PATHS_DEPTH];
+	void*				mem;
+	int					free = 0, cur = -1, next = 0, rc = 0;
+
+	if (ring_open(&r, PATHS_DEPTH) == -1) return 1;
+
+	mem = ckalloc(PATHS_DEPTH * PATHS_CHUNK + PATHS_ALIGN);
+	for (int s=0; s<PATHS_DEPTH; s++) {
+		slots[s].job  = -1;
+		slots[s].next = s+1 < PATHS_DEPTH ? s+1 : -1;
+		slots[s].buf  = aligned(mem) + s * PATHS_CHUNK;
+	}
+
+	while (next < p->count || cur != -1 || r.inflight) {
+		// Keep every slot busy: runs of reads ahead in a large file, and many small files at once
+		while (free != -1) {
+			if (cur != -1 && p->jobs[cur].eof) cur = -1;		// Failed while its reads were being issued
+			if (cur == -1) {
+				if (next == p->count) break;
+				cur = next++;
+				p->jobs[cur].head = p->jobs[cur].tail = -1;
+				job_open(p, &p->jobs[cur]);
+				if (p->jobs[cur].err) {
+					job_close(&p->jobs[cur]);
+					cur = -1;
+					continue;
+				}
+			}
+			ring_issue(p, &r, slots, &free, cur);
+			if (!p->jobs[cur].sized || p->jobs[cur].eof) cur = -1;
+		}
+
+		if (ring_enter(&r) == -1) {rc = -1; break;}
+
+		unsigned	head = *r.cq_head;
+		while (head != __atomic_load_n(r.cq_tail, __ATOMIC_ACQUIRE)) {
+			const struct io_uring_cqe*	cqe = &r.cqes[head & *r.cq_mask];
+
+			ring_complete(p, &r, slots, &free, cqe->user_data, cqe->res);
+			head++;
+		}
+		__atomic_store_n(r.cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	const int	err = errno, abandoned = r.inflight;
+	ring_close(&r);
+	// The kernel could still be writing to the buffers of reads in flight, so they're left be
+	if (!abandoned) ckfree(mem);
+	errno = err;
+	return rc;
+}
+
+//>>>
+//>>>
+#endif
+static int paths_run(Tcl_Interp* interp, struct paths* p) //<<<
+{
+#if HAVE_IO_URING
+	if (paths_engine != PATHS_PREAD) {
+		const int	rc = ring_run(p);
+
+		if (rc == -1) {
+			Tcl_SetObjResult(interp, Tcl_ObjPrintf("io_uring failed: %s", Tcl_PosixError(interp)));
+			return TCL_ERROR;
+		}
+		if (rc == 0) return TCL_OK;
+	}
+#else
+	(void)interp;
+#endif
+
+	pool_run(p);
+	return TCL_OK;
+}
+
+//>>>
+static int same_digest(Tcl_Obj* expected, Tcl_Obj* got, enum digest_format format) //<<<
+{
+	Tcl_Size	elen, glen;
+	const char*	e = Tcl_GetStringFromObj(expected, &elen);
+	const char*	g = Tcl_GetStringFromObj(got, &glen);
+
+	if (elen != glen) return 0;
+	return format == DIGEST_HEX ? strncasecmp(e, g, glen) == 0 : memcmp(e, g, glen) == 0;
+}
+
+//>>>
+static OBJCMD(paths_cmd) //<<<
+{
+	(void)cdata;
+	int					code = TCL_OK;
+	int					argi;
+	struct digest_opts	opts = {.format = DIGEST_BINARY};
+	struct paths		p = {0};
+	Tcl_Obj**			names = NULL;
+	Tcl_Obj**			expected = NULL;
+	Tcl_Obj*			res = NULL;
+
+	TEST_OK_LABEL(finally, code, digest_options(interp, objc, objv, 2, "?-direct? ?-format format? ?-manifest? alg paths", DIGEST_OPT_DIRECT|DIGEST_OPT_FORMAT|DIGEST_OPT_MANIFEST, &opts, &argi));
+	TEST_OK_LABEL(finally, code, hash_get_alg(interp, objv[argi], &p.alg));
+	p.direct = opts.direct;
+
+	if (opts.manifest) {
+		Tcl_DictSearch	search;
+		Tcl_Obj			*k, *v;
+		int				done;
+		Tcl_Size		size;
+
+		TEST_OK_LABEL(finally, code, Tcl_DictObjSize(interp, objv[argi+1], &size));
+		names    = ckalloc(sizeof(Tcl_Obj*) * (size ? size : 1));
+		expected = ckalloc(sizeof(Tcl_Obj*) * (size ? size : 1));
+		TEST_OK_LABEL(finally, code, Tcl_DictObjFirst(interp, objv[argi+1], &search, &k, &v, &done));
+		for (; !done; Tcl_DictObjNext(&search, &k, &v, &done)) {
+			names[p.count]    = k;
+			expected[p.count] = v;
+			p.count++;
+		}
+		Tcl_DictObjDone(&search);
+	} else {
+		Tcl_Obj**	ov;
+		Tcl_Size	oc;
+
+		TEST_OK_LABEL(finally, code, Tcl_ListObjGetElements(interp, objv[argi+1], &oc, &ov));
+		names = ckalloc(sizeof(Tcl_Obj*) * (oc ? oc : 1));
+		memcpy(names, ov, sizeof(Tcl_Obj*) * oc);
+		p.count = oc;
+	}
+
+	p.jobs = ckalloc(sizeof(struct path_job) * (p.count ? p.count : 1));
+	memset(p.jobs, 0, sizeof(struct path_job) * p.count);
+	for (int i=0; i<p.count; i++) {
+		p.jobs[i].fd     = -1;
+		p.jobs[i].native = Tcl_FSGetNativePath(names[i]);
+		if (p.jobs[i].native == NULL)
+			THROW_ERROR_LABEL(finally, code, "couldn't open \"", Tcl_GetString(names[i]), "\": not a native file");
+	}
+
+	TEST_OK_LABEL(finally, code, paths_run(interp, &p));
+
+	replace_tclobj(&res, opts.manifest ? Tcl_NewDictObj() : Tcl_NewListObj(0, NULL));
+	for (int i=0; i<p.count; i++) {
+		struct path_job*	j = &p.jobs[i];
+		Tcl_Obj*			digest = NULL;
+
+		if (j->err) {
+			if (!opts.manifest) {
+				Tcl_SetErrno(j->err);
+				THROW_PRINTF_LABEL(finally, code, "%s \"%s\": %s", j->what, Tcl_GetString(names[i]), Tcl_PosixError(interp));
+			}
+			Tcl_DictObjPut(NULL, res, names[i], Tcl_NewListObj(2, (Tcl_Obj*[]){
+				Tcl_NewStringObj("error", -1),
+				Tcl_ObjPrintf("%s \"%s\": %s", j->what, Tcl_GetString(names[i]), Tcl_ErrnoMsg(j->err))
+			}));
+			continue;
+		}
+
+		replace_tclobj(&digest, digest_obj(j->digest, j->digest_len, opts.format));
+		if (!opts.manifest) {
+			Tcl_ListObjAppendElement(NULL, res, digest);
+		} else if (!same_digest(expected[i], digest, opts.format)) {
+			Tcl_DictObjPut(NULL, res, names[i], Tcl_NewListObj(2, (Tcl_Obj*[]){Tcl_NewStringObj("got", -1), digest}));
+		}
+		release_tclobj(&digest);
+	}
+
+	Tcl_SetObjResult(interp, res);
+
+finally:
+	if (p.jobs) {
+		for (int i=0; i<p.count; i++) job_close(&p.jobs[i]);
+		ckfree(p.jobs);
+	}
+	if (names)		ckfree(names);
+	if (expected)	ckfree(expected);
+	release_tclobj(&res);
+	return code;
+}
+
+//>>>
+#if TESTMODE
+static int engine_available(enum paths_engine engine) //<<<
+{
+	if (engine != PATHS_IO_URING) return 1;
+#if HAVE_IO_URING
+	struct ring	r;
+
+	if (ring_open(&r, 1) == -1) return 0;
+	ring_close(&r);
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+//>>>
+static OBJCMD(paths_engine_cmd) //<<<
+{
+	(void)cdata;
+	int			code = TCL_OK;
+	int			idx;
+
+	enum {A_cmd, A_ENGINE, A_objc};
+	if (objc > A_objc) {
+		Tcl_WrongNumArgs(interp, A_cmd+1, objv, "?engine?");
+		code = TCL_ERROR;
+		goto finally;
+	}
+
+	if (objc > A_ENGINE) {
+		TEST_OK_LABEL(finally, code, Tcl_GetIndexFromObj(interp, objv[A_ENGINE], paths_engine_names, "engine", TCL_EXACT, &idx));
+		if (!engine_available(idx))
+			THROW_ERROR_LABEL(finally, code, "paths engine \"", paths_engine_names[idx], "\" not available");
+		paths_engine = idx;
+	}
+
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(paths_engine_names[paths_engine], -1));
+
+finally:
+	return code;
+}
+
+//>>>
+static OBJCMD(paths_engines_cmd) //<<<
+{
+	(void)cdata;
+	int			code = TCL_OK;
+
+	enum {A_cmd, A_objc};
+	CHECK_ARGS_LABEL(finally, code, "");
+
+	Tcl_Obj*	res = Tcl_NewListObj(0, NULL);
+	for (int i=PATHS_IO_URING; paths_engine_names[i]; i++)
+		if (engine_available(i))
+			Tcl_ListObjAppendElement(NULL, res, Tcl_NewStringObj(paths_engine_names[i], -1));
+
+	Tcl_SetObjResult(interp, res);
+
+finally:
+	return code;
+}
+
+//>>>
+#endif
+
+int paths_init(Tcl_Interp* interp) //<<<
+{
+	Tcl_CreateObjCommand(interp, NS "::paths",						paths_cmd,			NULL, NULL);
+#if TESTMODE
+	Tcl_CreateObjCommand(interp, NS "::_testmode_paths_engine",		paths_engine_cmd,	NULL, NULL);
+	Tcl_CreateObjCommand(interp, NS "::_testmode_paths_engines",	paths_engines_cmd,	NULL, NULL);
+#endif
+
+	return TCL_OK;
+}
+
+//>>>
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
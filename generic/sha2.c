@@ -34,7 +34,13 @@
 #include <string.h>	/* memcpy()/memset() or bcopy()/bzero() */
 #include <assert.h>	/* assert() */
 #include <endian.h>
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
 #include "sha2.h"
+#include "encode.h"
+#include "sha2_impl.h"
+#include "cpu.h"
 
 /*
  * ASSERT NOTE:
@@ -227,6 +233,118 @@ void SHA256_Transform(SHA256_CTX*, const sha2_word32*);
 void SHA512_Transform(SHA512_CTX*, const sha2_word64*);
 
 
+/*** RUNTIME TRANSFORM SELECTION **************************************/
+/*
+ * The Update/Final functions below process blocks through these, which
+ * sha2_select() points at the best implementation the host CPU supports
+ * (see sha2_impl.h).  The portable ones wrap SHA256/512_Transform, running
+ * them on a scratch context since those use the context buffer as the
+ * message schedule.
+ */
+static void sha256_blocks_portable(sha2_word32 state[8], const sha2_byte* data, size_t nblocks) {
+	SHA256_CTX	scratch;
+
+	MEMCPY_BCOPY(scratch.state, state, sizeof(scratch.state));
+	for (; nblocks; nblocks--, data += SHA256_BLOCK_LENGTH) {
+		SHA256_Transform(&scratch, (const sha2_word32*)data);
+	}
+	MEMCPY_BCOPY(state, scratch.state, sizeof(scratch.state));
+}
+
+static void sha512_blocks_portable(sha2_word64 state[8], const sha2_byte* data, size_t nblocks) {
+	SHA512_CTX	scratch;
+
+	MEMCPY_BCOPY(scratch.state, state, sizeof(scratch.state));
+	for (; nblocks; nblocks--, data += SHA512_BLOCK_LENGTH) {
+		SHA512_Transform(&scratch, (const sha2_word64*)data);
+	}
+	MEMCPY_BCOPY(state, scratch.state, sizeof(scratch.state));
+}
+
+const struct sha2_impl sha2_impl_portable = {
+	.name			= "portable",
+	.requires		= 0,
+	.sha256_blocks	= sha256_blocks_portable,
+	.sha512_blocks	= sha512_blocks_portable,
+};
+
+/*
+ * The multi-buffer AVX2 engine sits ahead of the AVX2/BMI2 single-stream
+ * transforms so that batches still get it, while SHA-NI beats both.
+ */
+const struct sha2_impl* const sha2_impls[] = {
+#if HAVE_SHA_NI
+	&sha2_impl_shani,
+#endif
+#if HAVE_AVX2
+	&sha2_impl_avx2,
+#endif
+#if HAVE_AVX2_BMI2
+	&sha2_impl_avx2_bmi2,
+#endif
+	&sha2_impl_portable,
+};
+const size_t sha2_impls_count = sizeof(sha2_impls) / sizeof(sha2_impls[0]);
+
+const char* const sha2_op_names[SHA2_OP_COUNT] = {
+	"sha256", "sha512", "sha256_x8", "sha512_x4"
+};
+
+static const struct sha2_impl	*sha2_installed[SHA2_OP_COUNT] = {
+	&sha2_impl_portable, &sha2_impl_portable, NULL, NULL
+};
+
+static int sha2_provides(const struct sha2_impl* impl, enum sha2_op op) {
+	switch (op) {
+		case SHA2_OP_SHA256:	return impl->sha256_blocks != NULL;
+		case SHA2_OP_SHA512:	return impl->sha512_blocks != NULL;
+		case SHA2_OP_SHA256_X8:	return impl->sha256_x8 != NULL;
+		case SHA2_OP_SHA512_X4:	return impl->sha512_x4 != NULL;
+		default:				return 0;
+	}
+}
+
+void sha2_select(const struct sha2_impl* impl) {
+	size_t	i;
+	int		op;
+
+	for (op = 0; op < SHA2_OP_COUNT; op++) {
+		/* The portable transforms always exist, the multi-buffer engines are optional */
+		const struct sha2_impl	*fallback = op <= SHA2_OP_SHA512 ? &sha2_impl_portable : NULL;
+
+		sha2_installed[op] = fallback;
+		if (impl != NULL) {
+			if (sha2_provides(impl, op)) sha2_installed[op] = impl;
+			continue;
+		}
+		for (i = 0; i < sha2_impls_count; i++) {
+			const struct sha2_impl	*candidate = sha2_impls[i];
+
+			if (!CPU_HAS(candidate->requires)) continue;
+			if (sha2_provides(candidate, op)) {
+				sha2_installed[op] = candidate;
+				break;
+			}
+			/*
+			 * A preferred single-stream kernel (SHA-NI) beats a multi-buffer
+			 * engine further down the list, so batches just loop over it.
+			 */
+			if (op == SHA2_OP_SHA256_X8 && candidate != &sha2_impl_portable && sha2_provides(candidate, SHA2_OP_SHA256)) break;
+			if (op == SHA2_OP_SHA512_X4 && candidate != &sha2_impl_portable && sha2_provides(candidate, SHA2_OP_SHA512)) break;
+		}
+	}
+}
+
+const struct sha2_impl* sha2_current(enum sha2_op op) {
+	return sha2_installed[op];
+}
+
+#define SHA256_BLOCKS(context, data, nblocks) \
+	sha2_installed[SHA2_OP_SHA256]->sha256_blocks((context)->state, (data), (nblocks))
+#define SHA512_BLOCKS(context, data, nblocks) \
+	sha2_installed[SHA2_OP_SHA512]->sha512_blocks((context)->state, (data), (nblocks))
+
+
 /*** SHA-XYZ INITIAL HASH VALUES AND CONSTANTS ************************/
 /* Hash constant words K for SHA-256: */
 static const sha2_word32 K256[64] = {
@@ -328,11 +446,6 @@ static const sha2_word64 sha512_initial_hash_value[8] = {
 	0x5be0cd19137e2179ULL
 };
 
-/*
- * Constant used by SHA256/384/512_End() functions for converting the
- * digest to a readable hexadecimal character string:
- */
-static const char *sha2_hex_digits = "0123456789abcdef";
 
 
 /*** SHA-256: *********************************************************/
@@ -542,7 +655,7 @@ void SHA256_Update(SHA256_CTX* context, const sha2_byte *data, size_t len) {
 			context->bitcount += freespace << 3;
 			len -= freespace;
 			data += freespace;
-			SHA256_Transform(context, (sha2_word32*)context->buffer);
+			SHA256_BLOCKS(context, context->buffer, 1);
 		} else {
 			/* The buffer is not yet full */
 			MEMCPY_BCOPY(&context->buffer[usedspace], data, len);
@@ -552,12 +665,14 @@ void SHA256_Update(SHA256_CTX* context, const sha2_byte *data, size_t len) {
 			return;
 		}
 	}
-	while (len >= SHA256_BLOCK_LENGTH) {
-		/* Process as many complete blocks as we can */
-		SHA256_Transform(context, (sha2_word32*)data);
-		context->bitcount += SHA256_BLOCK_LENGTH << 3;
-		len -= SHA256_BLOCK_LENGTH;
-		data += SHA256_BLOCK_LENGTH;
+	if (len >= SHA256_BLOCK_LENGTH) {
+		/* Process as many complete blocks as we can, in one go */
+		size_t	bulk = len - len % SHA256_BLOCK_LENGTH;
+
+		SHA256_BLOCKS(context, data, bulk / SHA256_BLOCK_LENGTH);
+		context->bitcount += (sha2_word64)bulk << 3;
+		len -= bulk;
+		data += bulk;
 	}
 	if (len > 0) {
 		/* There's left-overs, so save 'em */
@@ -594,7 +709,7 @@ void SHA256_Final(sha2_byte digest[SHA256_DIGEST_LENGTH], SHA256_CTX* context) {
 					MEMSET_BZERO(&context->buffer[usedspace], SHA256_BLOCK_LENGTH - usedspace);
 				}
 				/* Do second-to-last transform: */
-				SHA256_Transform(context, (sha2_word32*)context->buffer);
+				SHA256_BLOCKS(context, context->buffer, 1);
 
 				/* And set-up for the last transform: */
 				MEMSET_BZERO(context->buffer, SHA256_SHORT_BLOCK_LENGTH);
@@ -610,7 +725,7 @@ void SHA256_Final(sha2_byte digest[SHA256_DIGEST_LENGTH], SHA256_CTX* context) {
 		*(sha2_word64*)&context->buffer[SHA256_SHORT_BLOCK_LENGTH] = context->bitcount;
 
 		/* Final transform: */
-		SHA256_Transform(context, (sha2_word32*)context->buffer);
+		SHA256_BLOCKS(context, context->buffer, 1);
 
 #if BYTE_ORDER == LITTLE_ENDIAN
 		{
@@ -632,8 +747,7 @@ void SHA256_Final(sha2_byte digest[SHA256_DIGEST_LENGTH], SHA256_CTX* context) {
 }
 
 char *SHA256_End(SHA256_CTX* context, char buffer[SHA256_DIGEST_STRING_LENGTH]) {
-	sha2_byte	digest[SHA256_DIGEST_LENGTH], *d = digest;
-	int		i;
+	sha2_byte	digest[SHA256_DIGEST_LENGTH];
 
 	/* Sanity check: */
 	assert(context != (SHA256_CTX*)0);
@@ -641,11 +755,8 @@ char *SHA256_End(SHA256_CTX* context, char buffer[SHA256_DIGEST_STRING_LENGTH])
 	if (buffer != (char*)0) {
 		SHA256_Final(digest, context);
 
-		for (i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-			*buffer++ = sha2_hex_digits[(*d & 0xf0) >> 4];
-			*buffer++ = sha2_hex_digits[*d & 0x0f];
-			d++;
-		}
+		encode_hex(buffer, digest, SHA256_DIGEST_LENGTH);
+		buffer += SHA256_DIGEST_LENGTH * 2;
 		*buffer = (char)0;
 	} else {
 		MEMSET_BZERO(context, sizeof(SHA256_CTX));
@@ -864,7 +975,7 @@ void SHA512_Update(SHA512_CTX* context, const sha2_byte *data, size_t len) {
 			ADDINC128(context->bitcount, freespace << 3);
 			len -= freespace;
 			data += freespace;
-			SHA512_Transform(context, (sha2_word64*)context->buffer);
+			SHA512_BLOCKS(context, context->buffer, 1);
 		} else {
 			/* The buffer is not yet full */
 			MEMCPY_BCOPY(&context->buffer[usedspace], data, len);
@@ -874,12 +985,14 @@ void SHA512_Update(SHA512_CTX* context, const sha2_byte *data, size_t len) {
 			return;
 		}
 	}
-	while (len >= SHA512_BLOCK_LENGTH) {
-		/* Process as many complete blocks as we can */
-		SHA512_Transform(context, (sha2_word64*)data);
-		ADDINC128(context->bitcount, SHA512_BLOCK_LENGTH << 3);
-		len -= SHA512_BLOCK_LENGTH;
-		data += SHA512_BLOCK_LENGTH;
+	if (len >= SHA512_BLOCK_LENGTH) {
+		/* Process as many complete blocks as we can, in one go */
+		size_t	bulk = len - len % SHA512_BLOCK_LENGTH;
+
+		SHA512_BLOCKS(context, data, bulk / SHA512_BLOCK_LENGTH);
+		ADDINC128(context->bitcount, (sha2_word64)bulk << 3);
+		len -= bulk;
+		data += bulk;
 	}
 	if (len > 0) {
 		/* There's left-overs, so save 'em */
@@ -911,7 +1024,7 @@ void SHA512_Last(SHA512_CTX* context) {
 				MEMSET_BZERO(&context->buffer[usedspace], SHA512_BLOCK_LENGTH - usedspace);
 			}
 			/* Do second-to-last transform: */
-			SHA512_Transform(context, (sha2_word64*)context->buffer);
+			SHA512_BLOCKS(context, context->buffer, 1);
 
 			/* And set-up for the last transform: */
 			MEMSET_BZERO(context->buffer, SHA512_BLOCK_LENGTH - 2);
@@ -928,7 +1041,7 @@ void SHA512_Last(SHA512_CTX* context) {
 	*(sha2_word64*)&context->buffer[SHA512_SHORT_BLOCK_LENGTH+8] = context->bitcount[0];
 
 	/* Final transform: */
-	SHA512_Transform(context, (sha2_word64*)context->buffer);
+	SHA512_BLOCKS(context, context->buffer, 1);
 }
 
 void SHA512_Final(sha2_byte digest[SHA512_DIGEST_LENGTH], SHA512_CTX* context) {
@@ -961,8 +1074,7 @@ void SHA512_Final(sha2_byte digest[SHA512_DIGEST_LENGTH], SHA512_CTX* context) {
 }
 
 char *SHA512_End(SHA512_CTX* context, char buffer[SHA512_DIGEST_STRING_LENGTH]) {
-	sha2_byte	digest[SHA512_DIGEST_LENGTH], *d = digest;
-	int		i;
+	sha2_byte	digest[SHA512_DIGEST_LENGTH];
 
 	/* Sanity check: */
 	assert(context != (SHA512_CTX*)0);
@@ -970,11 +1082,8 @@ char *SHA512_End(SHA512_CTX* context, char buffer[SHA512_DIGEST_STRING_LENGTH])
 	if (buffer != (char*)0) {
 		SHA512_Final(digest, context);
 
-		for (i = 0; i < SHA512_DIGEST_LENGTH; i++) {
-			*buffer++ = sha2_hex_digits[(*d & 0xf0) >> 4];
-			*buffer++ = sha2_hex_digits[*d & 0x0f];
-			d++;
-		}
+		encode_hex(buffer, digest, SHA512_DIGEST_LENGTH);
+		buffer += SHA512_DIGEST_LENGTH * 2;
 		*buffer = (char)0;
 	} else {
 		MEMSET_BZERO(context, sizeof(SHA512_CTX));
@@ -1036,8 +1145,7 @@ void SHA384_Final(sha2_byte digest[SHA384_DIGEST_LENGTH], SHA384_CTX* context) {
 }
 
 char *SHA384_End(SHA384_CTX* context, char buffer[SHA384_DIGEST_STRING_LENGTH]) {
-	sha2_byte	digest[SHA384_DIGEST_LENGTH], *d = digest;
-	int		i;
+	sha2_byte	digest[SHA384_DIGEST_LENGTH];
 
 	/* Sanity check: */
 	assert(context != (SHA384_CTX*)0);
@@ -1045,11 +1153,8 @@ char *SHA384_End(SHA384_CTX* context, char buffer[SHA384_DIGEST_STRING_LENGTH])
 	if (buffer != (char*)0) {
 		SHA384_Final(digest, context);
 
-		for (i = 0; i < SHA384_DIGEST_LENGTH; i++) {
-			*buffer++ = sha2_hex_digits[(*d & 0xf0) >> 4];
-			*buffer++ = sha2_hex_digits[*d & 0x0f];
-			d++;
-		}
+		encode_hex(buffer, digest, SHA384_DIGEST_LENGTH);
+		buffer += SHA384_DIGEST_LENGTH * 2;
 		*buffer = (char)0;
 	} else {
 		MEMSET_BZERO(context, sizeof(SHA384_CTX));
@@ -1066,3 +1171,241 @@ char* SHA384_Data(const sha2_byte* data, size_t len, char digest[SHA384_DIGEST_S
 	return SHA384_End(&context, digest);
 }
 
+
+
+/*** SHA-256/384/512 BATCH: *******************************************/
+/*
+ * Hash count independent messages, running them through the multi-buffer
+ * engine (if one is installed) a lane per message.  Each lane works through
+ * its message's complete blocks straight from the caller's data and then
+ * the one or two padded final blocks built in the lane; a lane that
+ * finishes is refilled with the next waiting message.  When too few lanes
+ * are left busy to be worth it the stragglers finish on the single-stream
+ * transform.
+ */
+typedef struct _SHA2_LANE {
+	int		busy;
+	size_t		msg;		/* Index of the message in this lane */
+	const sha2_byte	*p;		/* Next block of the current segment */
+	size_t		left;		/* Blocks left in the current segment */
+	int		in_pad;		/* The current segment is pad[] */
+	size_t		pad_blocks;
+	sha2_byte	pad[2 * SHA512_BLOCK_LENGTH];
+} SHA2_LANE;
+
+static void sha2_lane_start(SHA2_LANE* lane, size_t msg, const sha2_byte* data, size_t len, size_t block_len) {
+	size_t		full = len / block_len, rem = len % block_len, end, i;
+	size_t		lenbytes = block_len == SHA256_BLOCK_LENGTH ? 8 : 16;
+	sha2_word64	bits = (sha2_word64)len << 3;
+
+	/* Build the padded final block(s) from the trailing partial block */
+	lane->pad_blocks = rem + 1 + lenbytes > block_len ? 2 : 1;
+	end = lane->pad_blocks * block_len;
+	MEMCPY_BCOPY(lane->pad, data + full * block_len, rem);
+	lane->pad[rem] = 0x80;
+	MEMSET_BZERO(&lane->pad[rem + 1], end - rem - 1);
+	for (i = 0; i < 8; i++) {
+		lane->pad[end - 1 - i] = (sha2_byte)(bits >> (8 * i));
+	}
+	if (lenbytes == 16) {
+		lane->pad[end - 9] = (sha2_byte)((sha2_word64)len >> 61);
+	}
+
+	lane->busy = 1;
+	lane->msg = msg;
+	if (full > 0) {
+		lane->p = data;
+		lane->left = full;
+		lane->in_pad = 0;
+	} else {
+		lane->p = lane->pad;
+		lane->left = lane->pad_blocks;
+		lane->in_pad = 1;
+	}
+}
+
+/* Move the lane on by n blocks, returns 1 when its message is done */
+static int sha2_lane_advance(SHA2_LANE* lane, size_t n, size_t block_len) {
+	lane->p += n * block_len;
+	lane->left -= n;
+	if (lane->left > 0) {
+		return 0;
+	}
+	if (lane->in_pad) {
+		lane->busy = 0;
+		return 1;
+	}
+	lane->p = lane->pad;
+	lane->left = lane->pad_blocks;
+	lane->in_pad = 1;
+	return 0;
+}
+
+/* Pick the step size and point idle lanes at some busy lane's data, returns the number of busy lanes */
+static unsigned int sha2_lanes_prepare(SHA2_LANE lane[], unsigned int lanes, const sha2_byte* ptr[], size_t* n) {
+	unsigned int	l, active = 0;
+	const sha2_byte	*spare = NULL;
+
+	*n = 0;
+	for (l = 0; l < lanes; l++) {
+		if (!lane[l].busy) continue;
+		active++;
+		spare = lane[l].p;
+		if (*n == 0 || lane[l].left < *n) {
+			*n = lane[l].left;
+		}
+	}
+	for (l = 0; l < lanes; l++) {
+		ptr[l] = lane[l].busy ? lane[l].p : spare;
+	}
+	return active;
+}
+
+void SHA256_Batch(size_t count, const sha2_byte* const data[], const size_t len[], sha2_byte digest[][SHA256_DIGEST_LENGTH]) {
+	const struct sha2_impl	*mb = sha2_installed[SHA2_OP_SHA256_X8];
+	const struct sha2_impl	*single = sha2_installed[SHA2_OP_SHA256];
+	SHA2_LANE	lane[8];
+	sha2_word32	state[8][8], st[8];
+	const sha2_byte	*ptr[8];
+	size_t		next = 0, n, i;
+	unsigned int	l, j, active;
+
+	if (mb == NULL) {
+		SHA256_CTX	context;
+
+		for (i = 0; i < count; i++) {
+			SHA256_Init(&context);
+			SHA256_Update(&context, data[i], len[i]);
+			SHA256_Final(digest[i], &context);
+		}
+		return;
+	}
+
+	MEMSET_BZERO(lane, sizeof(lane));
+	MEMSET_BZERO(state, sizeof(state));
+	for (;;) {
+		/* Refill idle lanes */
+		for (l = 0; l < 8 && next < count; l++) {
+			if (lane[l].busy) continue;
+			sha2_lane_start(&lane[l], next, data[next], len[next], SHA256_BLOCK_LENGTH);
+			for (j = 0; j < 8; j++) {
+				state[j][l] = sha256_initial_hash_value[j];
+			}
+			next++;
+		}
+
+		active = sha2_lanes_prepare(lane, 8, ptr, &n);
+		if (active == 0) {
+			break;
+		}
+		if (next == count && active * 4 <= 8) {
+			/* Nothing left to refill with, finish the stragglers single-stream */
+			for (l = 0; l < 8; l++) {
+				if (!lane[l].busy) continue;
+				for (j = 0; j < 8; j++) {
+					st[j] = state[j][l];
+				}
+				while (lane[l].busy) {
+					single->sha256_blocks(st, lane[l].p, lane[l].left);
+					sha2_lane_advance(&lane[l], lane[l].left, SHA256_BLOCK_LENGTH);
+				}
+				for (j = 0; j < 8; j++) {
+					state[j][l] = st[j];
+				}
+				for (j = 0; j < 32; j++) {
+					digest[lane[l].msg][j] = (sha2_byte)(state[j >> 2][l] >> (24 - 8 * (j & 3)));
+				}
+			}
+			break;
+		}
+
+		mb->sha256_x8(state, ptr, n);
+
+		for (l = 0; l < 8; l++) {
+			if (!lane[l].busy || !sha2_lane_advance(&lane[l], n, SHA256_BLOCK_LENGTH)) continue;
+			for (j = 0; j < 32; j++) {
+				digest[lane[l].msg][j] = (sha2_byte)(state[j >> 2][l] >> (24 - 8 * (j & 3)));
+			}
+		}
+	}
+}
+
+static void sha512_batch(size_t count, const sha2_byte* const data[], const size_t len[], sha2_byte* digest, size_t digest_len, const sha2_word64 initial[8]) {
+	const struct sha2_impl	*mb = sha2_installed[SHA2_OP_SHA512_X4];
+	const struct sha2_impl	*single = sha2_installed[SHA2_OP_SHA512];
+	SHA2_LANE	lane[4];
+	sha2_word64	state[8][4], st[8];
+	const sha2_byte	*ptr[4];
+	size_t		next = 0, n, i;
+	unsigned int	l, j, active;
+
+	if (mb == NULL) {
+		SHA512_CTX	context;
+		sha2_byte	full[SHA512_DIGEST_LENGTH];
+
+		for (i = 0; i < count; i++) {
+			SHA512_Init(&context);
+			MEMCPY_BCOPY(context.state, initial, sizeof(context.state));
+			SHA512_Update(&context, data[i], len[i]);
+			SHA512_Final(full, &context);
+			MEMCPY_BCOPY(digest + i * digest_len, full, digest_len);
+		}
+		return;
+	}
+
+	MEMSET_BZERO(lane, sizeof(lane));
+	MEMSET_BZERO(state, sizeof(state));
+	for (;;) {
+		/* Refill idle lanes */
+		for (l = 0; l < 4 && next < count; l++) {
+			if (lane[l].busy) continue;
+			sha2_lane_start(&lane[l], next, data[next], len[next], SHA512_BLOCK_LENGTH);
+			for (j = 0; j < 8; j++) {
+				state[j][l] = initial[j];
+			}
+			next++;
+		}
+
+		active = sha2_lanes_prepare(lane, 4, ptr, &n);
+		if (active == 0) {
+			break;
+		}
+		if (next == count && active * 4 <= 4) {
+			/* Nothing left to refill with, finish the straggler single-stream */
+			for (l = 0; l < 4; l++) {
+				if (!lane[l].busy) continue;
+				for (j = 0; j < 8; j++) {
+					st[j] = state[j][l];
+				}
+				while (lane[l].busy) {
+					single->sha512_blocks(st, lane[l].p, lane[l].left);
+					sha2_lane_advance(&lane[l], lane[l].left, SHA512_BLOCK_LENGTH);
+				}
+				for (j = 0; j < 8; j++) {
+					state[j][l] = st[j];
+				}
+				for (j = 0; j < digest_len; j++) {
+					digest[lane[l].msg * digest_len + j] = (sha2_byte)(state[j >> 3][l] >> (56 - 8 * (j & 7)));
+				}
+			}
+			break;
+		}
+
+		mb->sha512_x4(state, ptr, n);
+
+		for (l = 0; l < 4; l++) {
+			if (!lane[l].busy || !sha2_lane_advance(&lane[l], n, SHA512_BLOCK_LENGTH)) continue;
+			for (j = 0; j < digest_len; j++) {
+				digest[lane[l].msg * digest_len + j] = (sha2_byte)(state[j >> 3][l] >> (56 - 8 * (j & 7)));
+			}
+		}
+	}
+}
+
+void SHA384_Batch(size_t count, const sha2_byte* const data[], const size_t len[], sha2_byte digest[][SHA384_DIGEST_LENGTH]) {
+	sha512_batch(count, data, len, (sha2_byte*)digest, SHA384_DIGEST_LENGTH, sha384_initial_hash_value);
+}
+
+void SHA512_Batch(size_t count, const sha2_byte* const data[], const size_t len[], sha2_byte digest[][SHA512_DIGEST_LENGTH]) {
+	sha512_batch(count, data, len, (sha2_byte*)digest, SHA512_DIGEST_LENGTH, sha512_initial_hash_value);
+}
@@ -145,6 +145,10 @@ void SHA512_Final(uint8_t[SHA512_DIGEST_LENGTH], SHA512_CTX*);
 char* SHA512_End(SHA512_CTX*, char[SHA512_DIGEST_STRING_LENGTH]);
 char* SHA512_Data(const uint8_t*, size_t, char[SHA512_DIGEST_STRING_LENGTH]);
 
+void SHA256_Batch(size_t, const uint8_t* const[], const size_t[], uint8_t[][SHA256_DIGEST_LENGTH]);
+void SHA384_Batch(size_t, const uint8_t* const[], const size_t[], uint8_t[][SHA384_DIGEST_LENGTH]);
+void SHA512_Batch(size_t, const uint8_t* const[], const size_t[], uint8_t[][SHA512_DIGEST_LENGTH]);
+
 #else /* SHA2_USE_INTTYPES_H */
 
 void SHA256_Init(SHA256_CTX *);
@@ -165,6 +169,10 @@ void SHA512_Final(u_int8_t[SHA512_DIGEST_LENGTH], SHA512_CTX*);
 char* SHA512_End(SHA512_CTX*, char[SHA512_DIGEST_STRING_LENGTH]);
 char* SHA512_Data(const u_int8_t*, size_t, char[SHA512_DIGEST_STRING_LENGTH]);
 
+void SHA256_Batch(size_t, const u_int8_t* const[], const size_t[], u_int8_t[][SHA256_DIGEST_LENGTH]);
+void SHA384_Batch(size_t, const u_int8_t* const[], const size_t[], u_int8_t[][SHA384_DIGEST_LENGTH]);
+void SHA512_Batch(size_t, const u_int8_t* const[], const size_t[], u_int8_t[][SHA512_DIGEST_LENGTH]);
+
 #endif /* SHA2_USE_INTTYPES_H */
 
 #else /* NOPROTO */
@@ -187,6 +195,10 @@ void SHA512_Final();
 char* SHA512_End();
 char* SHA512_Data();
 
+void SHA256_Batch();
+void SHA384_Batch();
+void SHA512_Batch();
+
 #endif /* NOPROTO */
 
 #ifdef	__cplusplus
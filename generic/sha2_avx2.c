@@ -0,0 +1,212 @@
+/*
+ * AVX2 SHA-2 kernels.  Compiled with -mavx2, only called when the host CPU
+ * (and OS) report AVX2 support.
+ *
+ * The multi-buffer transforms run independent messages in the lanes of the
+ * vector registers: 8 SHA-256 states or 4 SHA-512 states, with the chaining
+ * values kept transposed (state[word][lane]) so that each state word is one
+ * vector.  The lane scheduling and padding is done by SHA256_Batch and
+ * SHA512_Batch in sha2.c.
+ */
+
+#include "sha2_impl.h"
+#include "cpu.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#include "avx2_util.h"
+
+static const uint32_t K256[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint64_t K512[80] = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+	0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+	0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+	0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+	0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+	0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+	0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+	0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+	0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+// Multi-buffer SHA-256, 8 lanes <<<
+#define ROR32(x, n)		_mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32-(n)))
+#define ADD32(a, b)		_mm256_add_epi32((a), (b))
+
+static inline void load_w256(__m256i w[16], const uint8_t* const data[8], size_t ofs) //<<<
+{
+	const __m256i	bswap = _mm256_set_epi8(
+		12,13,14,15, 8,9,10,11, 4,5,6,7, 0,1,2,3,
+		12,13,14,15, 8,9,10,11, 4,5,6,7, 0,1,2,3);
+
+	// Row i holds 8 message words of lane i, transposing gives 8 words of the schedule across the lanes
+	for (int half=0; half<2; half++) {
+		__m256i* r = w + half*8;
+		for (int i=0; i<8; i++)
+			r[i] = _mm256_loadu_si256((const __m256i*)(data[i] + ofs + half*32));
+		transpose8x32(r);
+		for (int i=0; i<8; i++)
+			r[i] = _mm256_shuffle_epi8(r[i], bswap);
+	}
+}
+
+//>>>
+static void avx2_sha256_x8(uint32_t state[8][8], const uint8_t* const data[8], size_t nblocks) //<<<
+{
+	__m256i	s[8], w[16];
+
+	for (int i=0; i<8; i++)
+		s[i] = _mm256_loadu_si256((const __m256i*)state[i]);
+
+	for (size_t ofs=0; nblocks; nblocks--, ofs += 64) {
+		__m256i	a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+
+		load_w256(w, data, ofs);
+
+		for (int t=0; t<64; t++) {
+			__m256i	wt;
+
+			if (t < 16) {
+				wt = w[t];
+			} else {
+				const __m256i	w15 = w[(t-15) & 15];
+				const __m256i	w2  = w[(t-2)  & 15];
+				const __m256i	s0  = _mm256_xor_si256(_mm256_xor_si256(ROR32(w15, 7), ROR32(w15, 18)), _mm256_srli_epi32(w15, 3));
+				const __m256i	s1  = _mm256_xor_si256(_mm256_xor_si256(ROR32(w2, 17), ROR32(w2, 19)), _mm256_srli_epi32(w2, 10));
+				wt = w[t & 15] = ADD32(ADD32(w[t & 15], s0), ADD32(w[(t-7) & 15], s1));
+			}
+
+			const __m256i	S1  = _mm256_xor_si256(_mm256_xor_si256(ROR32(e, 6), ROR32(e, 11)), ROR32(e, 25));
+			const __m256i	ch  = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+			const __m256i	T1  = ADD32(ADD32(ADD32(h, S1), ADD32(ch, _mm256_set1_epi32(K256[t]))), wt);
+			const __m256i	S0  = _mm256_xor_si256(_mm256_xor_si256(ROR32(a, 2), ROR32(a, 13)), ROR32(a, 22));
+			const __m256i	maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+
+			h = g; g = f; f = e;
+			e = ADD32(d, T1);
+			d = c; c = b; b = a;
+			a = ADD32(T1, ADD32(S0, maj));
+		}
+
+		s[0] = ADD32(s[0], a); s[1] = ADD32(s[1], b); s[2] = ADD32(s[2], c); s[3] = ADD32(s[3], d);
+		s[4] = ADD32(s[4], e); s[5] = ADD32(s[5], f); s[6] = ADD32(s[6], g); s[7] = ADD32(s[7], h);
+	}
+
+	for (int i=0; i<8; i++)
+		_mm256_storeu_si256((__m256i*)state[i], s[i]);
+}
+
+//>>>
+//>>>
+// Multi-buffer SHA-512, 4 lanes <<<
+#define ROR64(x, n)		_mm256_or_si256(_mm256_srli_epi64((x), (n)), _mm256_slli_epi64((x), 64-(n)))
+#define ADD64(a, b)		_mm256_add_epi64((a), (b))
+
+static inline void transpose4x64(__m256i r[4]) //<<<
+{
+	const __m256i	t0 = _mm256_unpacklo_epi64(r[0], r[1]);
+	const __m256i	t1 = _mm256_unpackhi_epi64(r[0], r[1]);
+	const __m256i	t2 = _mm256_unpacklo_epi64(r[2], r[3]);
+	const __m256i	t3 = _mm256_unpackhi_epi64(r[2], r[3]);
+	r[0] = _mm256_permute2x128_si256(t0, t2, 0x20);
+	r[1] = _mm256_permute2x128_si256(t1, t3, 0x20);
+	r[2] = _mm256_permute2x128_si256(t0, t2, 0x31);
+	r[3] = _mm256_permute2x128_si256(t1, t3, 0x31);
+}
+
+//>>>
+static inline void load_w512(__m256i w[16], const uint8_t* const data[4], size_t ofs) //<<<
+{
+	const __m256i	bswap = _mm256_set_epi8(
+		8,9,10,11,12,13,14,15, 0,1,2,3,4,5,6,7,
+		8,9,10,11,12,13,14,15, 0,1,2,3,4,5,6,7);
+
+	for (int quarter=0; quarter<4; quarter++) {
+		__m256i* r = w + quarter*4;
+		for (int i=0; i<4; i++)
+			r[i] = _mm256_loadu_si256((const __m256i*)(data[i] + ofs + quarter*32));
+		transpose4x64(r);
+		for (int i=0; i<4; i++)
+			r[i] = _mm256_shuffle_epi8(r[i], bswap);
+	}
+}
+
+//>>>
+static void avx2_sha512_x4(uint64_t state[8][4], const uint8_t* const data[4], size_t nblocks) //<<<
+{
+	__m256i	s[8], w[16];
+
+	for (int i=0; i<8; i++)
+		s[i] = _mm256_loadu_si256((const __m256i*)state[i]);
+
+	for (size_t ofs=0; nblocks; nblocks--, ofs += 128) {
+		__m256i	a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+
+		load_w512(w, data, ofs);
+
+		for (int t=0; t<80; t++) {
+			__m256i	wt;
+
+			if (t < 16) {
+				wt = w[t];
+			} else {
+				const __m256i	w15 = w[(t-15) & 15];
+				const __m256i	w2  = w[(t-2)  & 15];
+				const __m256i	s0  = _mm256_xor_si256(_mm256_xor_si256(ROR64(w15, 1), ROR64(w15, 8)), _mm256_srli_epi64(w15, 7));
+				const __m256i	s1  = _mm256_xor_si256(_mm256_xor_si256(ROR64(w2, 19), ROR64(w2, 61)), _mm256_srli_epi64(w2, 6));
+				wt = w[t & 15] = ADD64(ADD64(w[t & 15], s0), ADD64(w[(t-7) & 15], s1));
+			}
+
+			const __m256i	S1  = _mm256_xor_si256(_mm256_xor_si256(ROR64(e, 14), ROR64(e, 18)), ROR64(e, 41));
+			const __m256i	ch  = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+			const __m256i	T1  = ADD64(ADD64(ADD64(h, S1), ADD64(ch, _mm256_set1_epi64x((long long)K512[t]))), wt);
+			const __m256i	S0  = _mm256_xor_si256(_mm256_xor_si256(ROR64(a, 28), ROR64(a, 34)), ROR64(a, 39));
+			const __m256i	maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+
+			h = g; g = f; f = e;
+			e = ADD64(d, T1);
+			d = c; c = b; b = a;
+			a = ADD64(T1, ADD64(S0, maj));
+		}
+
+		s[0] = ADD64(s[0], a); s[1] = ADD64(s[1], b); s[2] = ADD64(s[2], c); s[3] = ADD64(s[3], d);
+		s[4] = ADD64(s[4], e); s[5] = ADD64(s[5], f); s[6] = ADD64(s[6], g); s[7] = ADD64(s[7], h);
+	}
+
+	for (int i=0; i<8; i++)
+		_mm256_storeu_si256((__m256i*)state[i], s[i]);
+}
+
+//>>>
+//>>>
+
+const struct sha2_impl sha2_impl_avx2 = {
+	.name			= "avx2",
+	.requires		= CPU_AVX2,
+	.sha256_x8		= avx2_sha256_x8,
+	.sha512_x4		= avx2_sha512_x4,
+};
+#endif
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
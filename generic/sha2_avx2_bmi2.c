@@ -0,0 +1,215 @@
+/*
+ * Single-stream SHA-256 and SHA-512 for CPUs without the SHA extensions:
+ * the message schedule is computed with AVX2 while the rounds stay scalar,
+ * where BMI2 gives the rotates as single non-destructive rorx instructions.
+ * Compiled with -mavx2 -mbmi2, only called when the host CPU (and OS) report
+ * support for both.
+ *
+ * SHA-256 schedules two blocks at once, one per 128 bit half of the
+ * registers, SHA-512 one block with 4 words per register.  The schedule
+ * (with the round constants already added) goes to a small buffer that the
+ * rounds read from.
+ */
+
+#include "sha2_impl.h"
+#include "cpu.h"
+
+#if defined(__AVX2__) && defined(__BMI2__)
+#include <immintrin.h>
+
+static const uint32_t K256[64] __attribute__((aligned(16))) = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint64_t K512[80] __attribute__((aligned(32))) = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+	0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+	0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+	0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+	0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+	0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+	0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+	0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+	0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+// SHA-256 <<<
+#define ROR32(x, n)		_mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32-(n)))
+#define SIG0_256(x)		_mm256_xor_si256(_mm256_xor_si256(ROR32((x),  7), ROR32((x), 18)), _mm256_srli_epi32((x),  3))
+#define SIG1_256(x)		_mm256_xor_si256(_mm256_xor_si256(ROR32((x), 17), ROR32((x), 19)), _mm256_srli_epi32((x), 10))
+
+#define R32(x, n)		(((x) >> (n)) | ((x) << (32-(n))))
+#define RND256(a, b, c, d, e, f, g, h, wk) do { \
+	const uint32_t	t1 = h + (R32(e, 6) ^ R32(e, 11) ^ R32(e, 25)) + ((e & f) ^ (~e & g)) + (wk); \
+	const uint32_t	t2 = (R32(a, 2) ^ R32(a, 13) ^ R32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c)); \
+	d += t1; \
+	h = t1 + t2; \
+} while (0)
+
+// Next 4 schedule words from the previous 16 (x0 oldest), in each 128 bit half independently
+static inline __m256i sched256(__m256i x0, __m256i x1, __m256i x2, __m256i x3) //<<<
+{
+	__m256i	w = _mm256_add_epi32(
+		_mm256_add_epi32(x0, SIG0_256(_mm256_alignr_epi8(x1, x0, 4))),	// W[t-16] + s0(W[t-15])
+		_mm256_alignr_epi8(x3, x2, 4));									// + W[t-7]
+
+	w = _mm256_add_epi32(w, SIG1_256(_mm256_srli_si256(x3, 8)));		// + s1(W[t-2]) for W[t], W[t+1]
+	return _mm256_add_epi32(w, SIG1_256(_mm256_slli_si256(w, 8)));		// + s1(W[t-2]) for W[t+2], W[t+3]
+}
+
+//>>>
+#define QROUNDS256(wk) do { \
+	RND256(a, b, c, d, e, f, g, h, (wk)[0]); \
+	RND256(h, a, b, c, d, e, f, g, (wk)[1]); \
+	RND256(g, h, a, b, c, d, e, f, (wk)[2]); \
+	RND256(f, g, h, a, b, c, d, e, (wk)[3]); \
+	/* Rotate the names back for the next 4 rounds */ \
+	uint32_t	tmp = a; a = e; e = tmp; tmp = b; b = f; f = tmp; tmp = c; c = g; g = tmp; tmp = d; d = h; h = tmp; \
+} while (0)
+
+static void avx2_bmi2_sha256_blocks(uint32_t state[8], const uint8_t* data, size_t nblocks) //<<<
+{
+	const __m256i	bswap = _mm256_set_epi8(
+		12,13,14,15, 8,9,10,11, 4,5,6,7, 0,1,2,3,
+		12,13,14,15, 8,9,10,11, 4,5,6,7, 0,1,2,3);
+	uint32_t		wk[16][8] __attribute__((aligned(32)));	// Group q: W+K[4q..4q+3] of the first block, then the second
+
+	for (; nblocks; nblocks -= nblocks > 1 ? 2 : 1, data += 128) {
+		// With an odd block out the second half just schedules the same block again
+		const uint8_t*	second = nblocks > 1 ? data + 64 : data;
+		uint32_t		a = state[0], b = state[1], c = state[2], d = state[3];
+		uint32_t		e = state[4], f = state[5], g = state[6], h = state[7];
+		__m256i			x[4];
+
+		for (int q=0; q<4; q++) {
+			x[q] = _mm256_shuffle_epi8(_mm256_inserti128_si256(
+				_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(data + 16*q))),
+				_mm_loadu_si128((const __m128i*)(second + 16*q)), 1), bswap);
+			_mm256_store_si256((__m256i*)wk[q], _mm256_add_epi32(x[q],
+				_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)&K256[4*q]))));
+		}
+
+		// The schedule runs 16 words ahead of the first block's rounds, giving the scalar and vector units independent work
+		for (int q=0; q<16; q++) {
+			if (q < 12) {
+				const __m256i	w = sched256(x[0], x[1], x[2], x[3]);
+				x[0] = x[1]; x[1] = x[2]; x[2] = x[3]; x[3] = w;
+				_mm256_store_si256((__m256i*)wk[q+4], _mm256_add_epi32(w,
+					_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)&K256[4*(q+4)]))));
+			}
+			QROUNDS256(wk[q]);
+		}
+		state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+		state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+
+		if (nblocks > 1) {
+			a = state[0]; b = state[1]; c = state[2]; d = state[3];
+			e = state[4]; f = state[5]; g = state[6]; h = state[7];
+			for (int q=0; q<16; q++)
+				QROUNDS256(wk[q] + 4);
+			state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+			state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+		}
+	}
+}
+
+//>>>
+//>>>
+// SHA-512 <<<
+#define ROR64(x, n)		_mm256_or_si256(_mm256_srli_epi64((x), (n)), _mm256_slli_epi64((x), 64-(n)))
+#define SIG0_512(x)		_mm256_xor_si256(_mm256_xor_si256(ROR64((x),  1), ROR64((x),  8)), _mm256_srli_epi64((x), 7))
+#define SIG1_512(x)		_mm256_xor_si256(_mm256_xor_si256(ROR64((x), 19), ROR64((x), 61)), _mm256_srli_epi64((x), 6))
+
+#define R64(x, n)		(((x) >> (n)) | ((x) << (64-(n))))
+#define RND512(a, b, c, d, e, f, g, h, wk) do { \
+	const uint64_t	t1 = h + (R64(e, 14) ^ R64(e, 18) ^ R64(e, 41)) + ((e & f) ^ (~e & g)) + (wk); \
+	const uint64_t	t2 = (R64(a, 28) ^ R64(a, 34) ^ R64(a, 39)) + ((a & b) ^ (a & c) ^ (b & c)); \
+	d += t1; \
+	h = t1 + t2; \
+} while (0)
+
+#define QROUNDS512(wk) do { \
+	RND512(a, b, c, d, e, f, g, h, (wk)[0]); \
+	RND512(h, a, b, c, d, e, f, g, (wk)[1]); \
+	RND512(g, h, a, b, c, d, e, f, (wk)[2]); \
+	RND512(f, g, h, a, b, c, d, e, (wk)[3]); \
+	/* Rotate the names back for the next 4 rounds */ \
+	uint64_t	tmp = a; a = e; e = tmp; tmp = b; b = f; f = tmp; tmp = c; c = g; g = tmp; tmp = d; d = h; h = tmp; \
+} while (0)
+
+// Words 1..4 of the 8 words in lo:hi
+#define WORDS_1_4(lo, hi)	_mm256_alignr_epi8(_mm256_permute2x128_si256((lo), (hi), 0x21), (lo), 8)
+
+static inline __m256i sched512(__m256i x0, __m256i x1, __m256i x2, __m256i x3) //<<<
+{
+	__m256i	w = _mm256_add_epi64(
+		_mm256_add_epi64(x0, SIG0_512(WORDS_1_4(x0, x1))),				// W[t-16] + s0(W[t-15])
+		WORDS_1_4(x2, x3));												// + W[t-7]
+
+	w = _mm256_add_epi64(w, SIG1_512(_mm256_permute2x128_si256(x3, x3, 0x81)));	// + s1(W[t-2]) for W[t], W[t+1]
+	return _mm256_add_epi64(w, SIG1_512(_mm256_permute2x128_si256(w, w, 0x08)));	// + s1(W[t-2]) for W[t+2], W[t+3]
+}
+
+//>>>
+static void avx2_bmi2_sha512_blocks(uint64_t state[8], const uint8_t* data, size_t nblocks) //<<<
+{
+	const __m256i	bswap = _mm256_set_epi8(
+		8,9,10,11,12,13,14,15, 0,1,2,3,4,5,6,7,
+		8,9,10,11,12,13,14,15, 0,1,2,3,4,5,6,7);
+	uint64_t		wk[80] __attribute__((aligned(32)));
+
+	for (; nblocks; nblocks--, data += 128) {
+		uint64_t	a = state[0], b = state[1], c = state[2], d = state[3];
+		uint64_t	e = state[4], f = state[5], g = state[6], h = state[7];
+		__m256i		x[4];
+
+		for (int q=0; q<4; q++) {
+			x[q] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(data + 32*q)), bswap);
+			_mm256_store_si256((__m256i*)&wk[4*q], _mm256_add_epi64(x[q], _mm256_load_si256((const __m256i*)&K512[4*q])));
+		}
+
+		// The schedule runs 16 words ahead of the rounds, giving the scalar and vector units independent work
+		for (int t=0; t<80; t+=4) {
+			if (t < 64) {
+				const __m256i	w = sched512(x[0], x[1], x[2], x[3]);
+				x[0] = x[1]; x[1] = x[2]; x[2] = x[3]; x[3] = w;
+				_mm256_store_si256((__m256i*)&wk[t+16], _mm256_add_epi64(w, _mm256_load_si256((const __m256i*)&K512[t+16])));
+			}
+			QROUNDS512(&wk[t]);
+		}
+
+		state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+		state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+	}
+}
+
+//>>>
+//>>>
+
+const struct sha2_impl sha2_impl_avx2_bmi2 = {
+	.name			= "avx2_bmi2",
+	.requires		= CPU_AVX2 | CPU_BMI2,
+	.sha256_blocks	= avx2_bmi2_sha256_blocks,
+	.sha512_blocks	= avx2_bmi2_sha512_blocks,
+};
+#endif
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
@@ -0,0 +1,64 @@
+#ifndef _HASH_SHA2_IMPL_H
+#define _HASH_SHA2_IMPL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Accelerated SHA-2 block transforms.  Like the Areion backends, each lives
+ * in its own translation unit compiled with the ISA flags it needs, and
+ * sha2.c installs the best one the host CPU supports (per algorithm) at
+ * init time, falling back to the portable SHA256/512_Transform.
+ *
+ * The block functions compress nblocks consecutive message blocks (64 bytes
+ * for SHA-256, 128 for SHA-512, big-endian as they appear in the message)
+ * into state, which holds the chaining value in host byte order.
+ *
+ * The multi-buffer functions do the same for independent messages in
+ * parallel lanes, with the chaining values transposed (state[word][lane])
+ * and data[lane] pointing at nblocks consecutive blocks for that lane.
+ * They back SHA256_Batch and SHA512_Batch.
+ *
+ * A NULL entry means the implementation doesn't provide that function.
+ */
+struct sha2_impl {
+	const char*		name;
+	unsigned int	requires;		// Mask of enum cpu_feature bits this implementation needs
+
+	void (*sha256_blocks)(uint32_t state[8], const uint8_t* data, size_t nblocks);
+	void (*sha512_blocks)(uint64_t state[8], const uint8_t* data, size_t nblocks);
+
+	void (*sha256_x8)(uint32_t state[8][8], const uint8_t* const data[8], size_t nblocks);
+	void (*sha512_x4)(uint64_t state[8][4], const uint8_t* const data[4], size_t nblocks);
+};
+
+enum sha2_op {
+	SHA2_OP_SHA256,
+	SHA2_OP_SHA512,
+	SHA2_OP_SHA256_X8,
+	SHA2_OP_SHA512_X4,
+	SHA2_OP_COUNT
+};
+
+extern const struct sha2_impl	sha2_impl_shani;
+extern const struct sha2_impl	sha2_impl_avx2;
+extern const struct sha2_impl	sha2_impl_avx2_bmi2;
+extern const struct sha2_impl	sha2_impl_portable;
+
+extern const struct sha2_impl* const	sha2_impls[];	// In order of preference, portable last
+extern const size_t						sha2_impls_count;
+
+extern const char* const	sha2_op_names[SHA2_OP_COUNT];
+
+/*
+ * Install impl for each function it provides (the portable transforms and
+ * no multi-buffer engine for the rest), or with impl == NULL the best the
+ * host CPU supports for each.  Call after cpu_detect().
+ */
+void sha2_select(const struct sha2_impl* impl);
+
+const struct sha2_impl* sha2_current(enum sha2_op op);		// NULL if none installed
+
+#endif
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
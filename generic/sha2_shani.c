@@ -0,0 +1,96 @@
+/*
+ * SHA-256 using the x86 SHA extensions (SHA-NI).  Compiled with -msse4.1
+ * -msha, only called when the host CPU reports support for both.
+ */
+
+#include "sha2_impl.h"
+#include "cpu.h"
+
+#if defined(__SHA__) && defined(__SSE4_1__)
+#include <immintrin.h>
+
+static const uint32_t K256[64] __attribute__((aligned(16))) = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+/*
+ * Four rounds g*4 .. g*4+3 on the message words in cur.  Interleaved with
+ * the rounds (they don't depend on the state): if msg2, finish the schedule
+ * for next from cur and prev, and if msg1, start it for prev.
+ */
+#define QROUNDS(g, cur, prev, next, msg2, msg1) do { \
+	__m128i	wk = _mm_add_epi32(cur, _mm_load_si128((const __m128i*)&K256[4*(g)])); \
+	cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk); \
+	if (msg2) { \
+		next = _mm_add_epi32(next, _mm_alignr_epi8(cur, prev, 4)); \
+		next = _mm_sha256msg2_epu32(next, cur); \
+	} \
+	wk = _mm_shuffle_epi32(wk, 0x0e); \
+	abef = _mm_sha256rnds2_epu32(abef, cdgh, wk); \
+	if (msg1) prev = _mm_sha256msg1_epu32(prev, cur); \
+} while (0)
+
+static void shani_sha256_blocks(uint32_t state[8], const uint8_t* data, size_t nblocks) //<<<
+{
+	const __m128i	bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i			abef, cdgh, tmp, m0, m1, m2, m3;
+
+	// The rnds2 instruction wants the state as {ABEF} and {CDGH}
+	tmp  = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[0]), 0xb1);	// CDAB
+	cdgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[4]), 0x1b);	// EFGH
+	abef = _mm_alignr_epi8(tmp, cdgh, 8);
+	cdgh = _mm_blend_epi16(cdgh, tmp, 0xf0);
+
+	for (; nblocks; nblocks--, data += 64) {
+		const __m128i	abef_save = abef;
+		const __m128i	cdgh_save = cdgh;
+
+		m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data)),      bswap);
+		m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), bswap);
+		m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), bswap);
+		m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), bswap);
+
+		QROUNDS( 0, m0, m3, m1, 0, 0);
+		QROUNDS( 1, m1, m0, m2, 0, 1);
+		QROUNDS( 2, m2, m1, m3, 0, 1);
+		QROUNDS( 3, m3, m2, m0, 1, 1);
+		QROUNDS( 4, m0, m3, m1, 1, 1);
+		QROUNDS( 5, m1, m0, m2, 1, 1);
+		QROUNDS( 6, m2, m1, m3, 1, 1);
+		QROUNDS( 7, m3, m2, m0, 1, 1);
+		QROUNDS( 8, m0, m3, m1, 1, 1);
+		QROUNDS( 9, m1, m0, m2, 1, 1);
+		QROUNDS(10, m2, m1, m3, 1, 1);
+		QROUNDS(11, m3, m2, m0, 1, 1);
+		QROUNDS(12, m0, m3, m1, 1, 1);
+		QROUNDS(13, m1, m0, m2, 1, 0);
+		QROUNDS(14, m2, m1, m3, 1, 0);
+		QROUNDS(15, m3, m2, m0, 0, 0);
+
+		abef = _mm_add_epi32(abef, abef_save);
+		cdgh = _mm_add_epi32(cdgh, cdgh_save);
+	}
+
+	tmp  = _mm_shuffle_epi32(abef, 0x1b);		// FEBA
+	cdgh = _mm_shuffle_epi32(cdgh, 0xb1);		// DCHG
+	_mm_storeu_si128((__m128i*)&state[0], _mm_blend_epi16(tmp, cdgh, 0xf0));	// DCBA
+	_mm_storeu_si128((__m128i*)&state[4], _mm_alignr_epi8(cdgh, tmp, 8));		// HGFE
+}
+
+//>>>
+
+const struct sha2_impl sha2_impl_shani = {
+	.name			= "shani",
+	.requires		= CPU_SSE41 | CPU_SHA,
+	.sha256_blocks	= shani_sha256_blocks,
+};
+#endif
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
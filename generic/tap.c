@@ -0,0 +1,291 @@
+#include "hashInt.h"
+#include <errno.h>
+#include <string.h>
+
+/*
+ * Hash taps: a channel transform that passes every byte straight through
+ * and hashes it on the way, with a set of contexts for each direction, so
+ * whatever is copied through a channel is hashed without a second pass.
+ * The bytes are hashed in the buffer Tcl hands the transform, with no copy
+ * of their own.  What has been read is what the transform has pulled from
+ * the channel below, which runs ahead of what the script has read until
+ * EOF, and what it has read ahead is dropped when it's popped, as with any
+ * transform.  What has been written is what has been flushed down, so
+ * output is flushed before taking its digests.
+ */
+
+enum {TAP_READ, TAP_WRITE};
+
+struct tap {
+	Tcl_Channel			chan;			// This transform
+	int					nalgs;
+	enum hash_alg_id	algs[HASH_ALG_COUNT];
+	struct hash_ctx*	ctx[2][HASH_ALG_COUNT];		// Indexed by TAP_READ or TAP_WRITE, NULL where the channel doesn't go that way
+};
+
+// Channel driver <<<
+static int tap_close(ClientData cdata, Tcl_Interp* interp, int flags) //<<<
+{
+	(void)interp;
+	struct tap*	tap = cdata;
+
+	if (flags & (TCL_CLOSE_READ | TCL_CLOSE_WRITE)) return EINVAL;		// Tcl doesn't half close stacks anyway
+
+	for (int dir=TAP_READ; dir<=TAP_WRITE; dir++)
+		for (int i=0; i<tap->nalgs; i++)
+			if (tap->ctx[dir][i]) hash_end(tap->ctx[dir][i], NULL);
+	ckfree(tap);
+	return 0;
+}
+
+//>>>
+static int tap_input(ClientData cdata, char* buf, int toRead, int* errorCodePtr) //<<<
+{
+	struct tap*		tap = cdata;
+	const Tcl_Size	got = Tcl_ReadRaw(Tcl_GetStackedChannel(tap->chan), buf, toRead);
+
+	if (got < 0) {
+		*errorCodePtr = Tcl_GetErrno();
+		return -1;
+	}
+
+	for (int i=0; i<tap->nalgs; i++)
+		hash_update(tap->ctx[TAP_READ][i], (const uint8_t*)buf, got);
+
+	return got;
+}
+
+//>>>
+static int tap_output(ClientData cdata, const char* buf, int toWrite, int* errorCodePtr) //<<<
+{
+	struct tap*		tap = cdata;
+	const Tcl_Size	wrote = Tcl_WriteRaw(Tcl_GetStackedChannel(tap->chan), buf, toWrite);
+
+	if (wrote < 0) {
+		*errorCodePtr = Tcl_GetErrno();
+		return -1;
+	}
+
+	// Only what the channel below took, the rest will be offered again
+	for (int i=0; i<tap->nalgs; i++)
+		hash_update(tap->ctx[TAP_WRITE][i], (const uint8_t*)buf, wrote);
+
+	return wrote;
+}
+
+//>>>
+static int tap_set_option(ClientData cdata, Tcl_Interp* interp, const char* name, const char* value) //<<<
+{
+	struct tap*					tap    = cdata;
+	Tcl_Channel					parent = Tcl_GetStackedChannel(tap->chan);
+	Tcl_DriverSetOptionProc*	proc   = Tcl_ChannelSetOptionProc(Tcl_GetChannelType(parent));
+
+	if (proc == NULL) return Tcl_BadChannelOption(interp, name, "");
+	return proc(Tcl_GetChannelInstanceData(parent), interp, name, value);
+}
+
+//>>>
+static int tap_get_option(ClientData cdata, Tcl_Interp* interp, const char* name, Tcl_DString* ds) //<<<
+{
+	struct tap*					tap    = cdata;
+	Tcl_Channel					parent = Tcl_GetStackedChannel(tap->chan);
+	Tcl_DriverGetOptionProc*	proc   = Tcl_ChannelGetOptionProc(Tcl_GetChannelType(parent));
+
+	if (proc) return proc(Tcl_GetChannelInstanceData(parent), interp, name, ds);
+	if (name == NULL) return TCL_OK;
+	return Tcl_BadChannelOption(interp, name, "");
+}
+
+//>>>
+static void tap_watch(ClientData cdata, int mask) //<<<
+{
+	struct tap*		tap    = cdata;
+	Tcl_Channel		parent = Tcl_GetStackedChannel(tap->chan);
+
+	Tcl_ChannelWatchProc(Tcl_GetChannelType(parent))(Tcl_GetChannelInstanceData(parent), mask);
+}
+
+//>>>
+static int tap_get_handle(ClientData cdata, int direction, ClientData* handlePtr) //<<<
+{
+	struct tap*		tap = cdata;
+
+	return Tcl_GetChannelHandle(Tcl_GetStackedChannel(tap->chan), direction, handlePtr);
+}
+
+//>>>
+static int tap_block_mode(ClientData cdata, int mode) //<<<
+{
+	(void)cdata; (void)mode;
+	return 0;		// Tcl sets it on the channel below itself
+}
+
+//>>>
+static int tap_handler(ClientData cdata, int mask) //<<<
+{
+	(void)cdata;
+	return mask;
+}
+
+//>>>
+
+static const Tcl_ChannelType tap_channel_type = {
+	.typeName			= "hash::tap",
+	.version			= TCL_CHANNEL_VERSION_5,
+#if TCL_MAJOR_VERSION < 9
+	.closeProc			= TCL_CLOSE2PROC,
+#endif
+	.inputProc			= tap_input,
+	.outputProc			= tap_output,
+	.setOptionProc		= tap_set_option,
+	.getOptionProc		= tap_get_option,
+	.watchProc			= tap_watch,
+	.getHandleProc		= tap_get_handle,
+	.close2Proc			= tap_close,
+	.blockModeProc		= tap_block_mode,
+	.handlerProc		= tap_handler,
+};
+
+//>>>
+// Find the tap in the stack of the channel named by obj, which must be the top with top set
+static int get_tap(Tcl_Interp* interp, Tcl_Obj* obj, int top, struct tap** tap) //<<<
+{
+	int				mode;
+	Tcl_Channel		chan = Tcl_GetChannel(interp, Tcl_GetString(obj), &mode);
+
+	if (chan == NULL) return TCL_ERROR;
+
+	// Tcl_GetChannel gives the bottom of the stack, search down from the top
+	for (chan = Tcl_GetTopChannel(chan); chan; chan = top ? NULL : Tcl_GetStackedChannel(chan)) {
+		if (Tcl_GetChannelType(chan) == &tap_channel_type) {
+			*tap = Tcl_GetChannelInstanceData(chan);
+			return TCL_OK;
+		}
+	}
+
+	THROW_ERROR("channel \"", Tcl_GetString(obj), top ? "\" has no hash tap on top" : "\" has no hash tap");
+}
+
+//>>>
+// A dict of the digests so far, by direction then algorithm, after flushing the output
+static Tcl_Obj* tap_digests(struct tap* tap, enum digest_format format) //<<<
+{
+	static const char* const	dirs[] = {"read", "write"};
+	Tcl_Obj*					res = Tcl_NewDictObj();
+	uint8_t						digest[64];
+
+	if (tap->ctx[TAP_WRITE][0]) Tcl_Flush(tap->chan);
+
+	for (int dir=TAP_READ; dir<=TAP_WRITE; dir++) {
+		if (tap->ctx[dir][0] == NULL) continue;
+
+		Tcl_Obj*	digests = Tcl_NewDictObj();
+		for (int i=0; i<tap->nalgs; i++) {
+			const size_t	digest_len = hash_digest(tap->ctx[dir][i], digest);
+			Tcl_DictObjPut(NULL, digests, Tcl_NewStringObj(hash_name(tap->algs[i]), -1), digest_obj(digest, digest_len, format));
+		}
+		Tcl_DictObjPut(NULL, res, Tcl_NewStringObj(dirs[dir], -1), digests);
+	}
+
+	return res;
+}
+
+//>>>
+static OBJCMD(tap_push_cmd) //<<<
+{
+	(void)cdata;
+	int				code = TCL_OK;
+	int				mode;
+	Tcl_Channel		chan;
+	struct tap*		tap = NULL;
+
+	if (objc < 3) {
+		Tcl_WrongNumArgs(interp, 1, objv, "channel alg ?alg ...?");
+		code = TCL_ERROR;
+		goto finally;
+	}
+
+	chan = Tcl_GetChannel(interp, Tcl_GetString(objv[1]), &mode);
+	if (chan == NULL) {code = TCL_ERROR; goto finally;}
+
+	tap = ckalloc(sizeof(*tap));
+	memset(tap, 0, sizeof(*tap));
+
+	for (int i=2; i<objc; i++) {
+		enum hash_alg_id	alg;
+		int					seen = 0;
+
+		TEST_OK_LABEL(finally, code, hash_get_alg(interp, objv[i], &alg));
+		for (int j=0; j<tap->nalgs; j++) seen |= tap->algs[j] == alg;
+		if (!seen) tap->algs[tap->nalgs++] = alg;
+	}
+
+	for (int i=0; i<tap->nalgs; i++) {
+		if (mode & TCL_READABLE) tap->ctx[TAP_READ][i]  = hash_begin(tap->algs[i]);
+		if (mode & TCL_WRITABLE) tap->ctx[TAP_WRITE][i] = hash_begin(tap->algs[i]);
+	}
+
+	tap->chan = Tcl_StackChannel(interp, &tap_channel_type, tap, mode, chan);
+	if (tap->chan == NULL) {code = TCL_ERROR; goto finally;}
+	tap = NULL;		// Owned by the channel now
+
+	Tcl_SetObjResult(interp, objv[1]);
+
+finally:
+	if (tap) tap_close(tap, NULL, 0);
+	return code;
+}
+
+//>>>
+static OBJCMD(tap_digests_cmd) //<<<
+{
+	(void)cdata;
+	struct digest_opts	opts = {.format = DIGEST_BINARY};
+	struct tap*			tap;
+	int					argi;
+
+	TEST_OK(digest_options(interp, objc, objv, 1, "?-format format? channel", DIGEST_OPT_FORMAT, &opts, &argi));
+	TEST_OK(get_tap(interp, objv[argi], 0, &tap));
+
+	Tcl_SetObjResult(interp, tap_digests(tap, opts.format));
+	return TCL_OK;
+}
+
+//>>>
+static OBJCMD(tap_pop_cmd) //<<<
+{
+	(void)cdata;
+	int					code = TCL_OK;
+	struct digest_opts	opts = {.format = DIGEST_BINARY};
+	struct tap*			tap;
+	int					argi;
+	Tcl_Obj*			res = NULL;
+
+	TEST_OK_LABEL(finally, code, digest_options(interp, objc, objv, 1, "?-format format? channel", DIGEST_OPT_FORMAT, &opts, &argi));
+	TEST_OK_LABEL(finally, code, get_tap(interp, objv[argi], 1, &tap));
+
+	// Taken before unstacking, which frees the tap
+	replace_tclobj(&res, tap_digests(tap, opts.format));
+	TEST_OK_LABEL(finally, code, Tcl_UnstackChannel(interp, tap->chan));
+
+	Tcl_SetObjResult(interp, res);
+
+finally:
+	release_tclobj(&res);
+	return code;
+}
+
+//>>>
+
+int tap_init(Tcl_Interp* interp) //<<<
+{
+	Tcl_CreateObjCommand(interp, NS "::tap_push",		tap_push_cmd,		NULL, NULL);
+	Tcl_CreateObjCommand(interp, NS "::tap_digests",	tap_digests_cmd,	NULL, NULL);
+	Tcl_CreateObjCommand(interp, NS "::tap_pop",		tap_pop_cmd,		NULL, NULL);
+
+	return TCL_OK;
+}
+
+//>>>
+
+// vim: foldmethod=marker foldmarker=<<<,>>> ts=4 shiftwidth=4 noexpandtab
@@ -7,3 +7,30 @@ loadTestedCommands
 package require hash
 
 testConstraint testMode [expr {[llength [info commands ::hash::::_testmode_areion_vlif_init_state]]>0}]
+
+testConstraint exec [llength [auto_execok cat]]
+testConstraint procfs [file readable /proc/version]
+
+# Binary files in the temporary directory for the tests that hash files and channels
+proc write_file {name bytes} { #<<<
+	set fn	[file join [temporaryDirectory] $name]
+	set h	[open $fn wb]
+	try {
+		puts -nonewline $h $bytes
+	} finally {
+		close $h
+	}
+	set fn
+}
+
+#>>>
+proc read_file fn { #<<<
+	set h	[open $fn rb]
+	try {
+		read $h
+	} finally {
+		close $h
+	}
+}
+
+#>>>